@@ -55,43 +55,39 @@ void bitset::clear_all() {
   memset(m_data, 0, bytes_for_size(m_size));
 }
 
+// Bits past |m_size| in the last word are always clear, whole words are counted
+// and searched at once.
 rx_size bitset::count_set_bits() const {
   rx_size count{0};
 
-  for (rx_size i{0}; i < m_size; i++) {
-    if (test(i)) {
-      count++;
-    }
+  const rx_size words{bytes_for_size(m_size) / sizeof(bit_type)};
+  for (rx_size i{0}; i < words; i++) {
+    count += bit_pop_count(m_data[i]);
   }
 
   return count;
 }
 
 rx_size bitset::count_unset_bits() const {
-  rx_size count{0};
-
-  for (rx_size i{0}; i < m_size; i++) {
-    if (!test(i)) {
-      count++;
-    }
-  }
-
-  return count;
+  return m_size - count_set_bits();
 }
 
 rx_size bitset::find_first_unset() const {
-  for (rx_size i{0}; i < m_size; i++) {
-    if (!test(i)) {
-      return i;
+  const rx_size words{bytes_for_size(m_size) / sizeof(bit_type)};
+  for (rx_size i{0}; i < words; i++) {
+    if (const bit_type word{~m_data[i]}) {
+      const rx_size bit{i * k_word_bits + bit_search_lsb(word)};
+      return bit < m_size ? bit : -1_z;
     }
   }
   return -1_z;
 }
 
 rx_size bitset::find_first_set() const {
-  for (rx_size i{0}; i < m_size; i++) {
-    if (test(i)) {
-      return i;
+  const rx_size words{bytes_for_size(m_size) / sizeof(bit_type)};
+  for (rx_size i{0}; i < words; i++) {
+    if (const bit_type word{m_data[i]}) {
+      return i * k_word_bits + bit_search_lsb(word);
     }
   }
   return -1_z;
@@ -9,6 +9,7 @@
 #include "rx/core/memory/system_allocator.h"
 
 #include "rx/core/utility/exchange.h"
+#include "rx/core/utility/bit.h"
 
 namespace rx {
 
@@ -126,14 +127,16 @@ inline rx_size bitset::offset(rx_size _bit) {
 
 template<typename F>
 inline void bitset::each_set(F&& _function) const {
-  for (rx_size i{0}; i < m_size; i++) {
-    if (test(i)) {
+  const rx_size words{bytes_for_size(m_size) / sizeof(bit_type)};
+  for (rx_size i{0}; i < words; i++) {
+    for (bit_type word{m_data[i]}; word; word &= word - 1) {
+      const rx_size bit{i * k_word_bits + bit_search_lsb(word)};
       if constexpr (traits::is_same<bool, traits::return_type<F>>) {
-        if (!_function(i)) {
+        if (!_function(bit)) {
           return;
         }
       } else {
-        _function(i);
+        _function(bit);
       }
     }
   }
@@ -141,14 +144,19 @@ inline void bitset::each_set(F&& _function) const {
 
 template<typename F>
 inline void bitset::each_unset(F&& _function) const {
-  for (rx_size i{0}; i < m_size; i++) {
-    if (!test(i)) {
+  const rx_size words{bytes_for_size(m_size) / sizeof(bit_type)};
+  for (rx_size i{0}; i < words; i++) {
+    for (bit_type word{~m_data[i]}; word; word &= word - 1) {
+      const rx_size bit{i * k_word_bits + bit_search_lsb(word)};
+      if (bit >= m_size) {
+        return;
+      }
       if constexpr (traits::is_same<bool, traits::return_type<F>>) {
-        if (!_function(i)) {
+        if (!_function(bit)) {
           return;
         }
       } else {
-        _function(i);
+        _function(bit);
       }
     }
   }
@@ -0,0 +1,54 @@
+#include "rx/core/concurrency/async_counter.h"
+
+#if defined(__cpp_impl_coroutine)
+#include "rx/core/concurrency/scope_lock.h"
+
+namespace rx::concurrency {
+
+void async_counter::add(rx_size _count) {
+  scope_lock lock{m_lock};
+  m_count += _count;
+}
+
+void async_counter::signal() {
+  // The counter may be destroyed as soon as |m_lock| is released, only locals
+  // are used after it.
+  thread_pool* pool{nullptr};
+  waiter* waiters{nullptr};
+  {
+    scope_lock lock{m_lock};
+    RX_ASSERT(m_count, "signaled too many times");
+    if (--m_count != 0) {
+      return;
+    }
+    waiters = utility::exchange(m_waiters, nullptr);
+    pool = &m_pool;
+  }
+
+  // The awaiter lives in the frame of the suspended coroutine, read the next
+  // waiter before resuming anything.
+  while (waiters) {
+    const auto handle{waiters->handle};
+    waiters = waiters->next;
+    pool->add([handle](int) { handle.resume(); });
+  }
+}
+
+bool async_counter::is_zero() {
+  scope_lock lock{m_lock};
+  return m_count == 0;
+}
+
+bool async_counter::suspend(waiter* _waiter) {
+  scope_lock lock{m_lock};
+  if (m_count == 0) {
+    return false;
+  }
+  _waiter->next = m_waiters;
+  m_waiters = _waiter;
+  return true;
+}
+
+} // namespace rx::concurrency
+
+#endif // defined(__cpp_impl_coroutine)
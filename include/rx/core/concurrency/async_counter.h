@@ -0,0 +1,92 @@
+#ifndef RX_CORE_CONCURRENCY_ASYNC_COUNTER_H
+#define RX_CORE_CONCURRENCY_ASYNC_COUNTER_H
+#include "rx/core/concurrency/task.h"
+#include "rx/core/concurrency/spin_lock.h"
+
+#if defined(__cpp_impl_coroutine)
+
+namespace rx::concurrency {
+
+// # Async Counter
+//
+// Coroutine counterpart of |wait_group|. Tasks awaiting the counter with
+// |co_await| are suspended until the count drops to zero, without blocking the
+// worker they ran on. Once the count drops to zero every suspended task is
+// added back to |_pool| as a job.
+//
+// The counter can be raised again with |add| after it reached zero, tasks
+// which await it after that are suspended until it reaches zero again.
+struct RX_HINT_EMPTY_BASES async_counter
+  : concepts::no_copy
+  , concepts::no_move
+{
+  async_counter(thread_pool& _pool, rx_size _count);
+  async_counter(thread_pool& _pool);
+
+  // raise the count by |_count|
+  void add(rx_size _count = 1);
+
+  // lower the count by one, resumes the waiting tasks when it reaches zero
+  void signal();
+
+  bool is_zero();
+
+  auto operator co_await() noexcept;
+
+private:
+  struct waiter {
+    std::coroutine_handle<> handle;
+    waiter* next;
+  };
+
+  // Returns false when the count is already zero and the awaiting coroutine
+  // should not suspend.
+  bool suspend(waiter* _waiter);
+
+  thread_pool& m_pool;
+
+  // Everything is protected by |m_lock|, including the count. A task awaiting
+  // the counter may destroy it as soon as it observed a count of zero, which
+  // must not happen while |signal| still accesses the counter.
+  spin_lock m_lock;
+  rx_size m_count;   // protected by |m_lock|
+  waiter* m_waiters; // protected by |m_lock|
+};
+
+inline async_counter::async_counter(thread_pool& _pool, rx_size _count)
+  : m_pool{_pool}
+  , m_count{_count}
+  , m_waiters{nullptr}
+{
+}
+
+inline async_counter::async_counter(thread_pool& _pool)
+  : async_counter{_pool, 0}
+{
+}
+
+inline auto async_counter::operator co_await() noexcept {
+  struct awaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> _handle) noexcept {
+      node.handle = _handle;
+      return counter.suspend(&node);
+    }
+
+    void await_resume() const noexcept {}
+
+    async_counter& counter;
+    waiter node;
+  };
+
+  return awaiter{*this, {nullptr, nullptr}};
+}
+
+} // namespace rx::concurrency
+
+#endif // defined(__cpp_impl_coroutine)
+
+#endif // RX_CORE_CONCURRENCY_ASYNC_COUNTER_H
@@ -0,0 +1,67 @@
+#include "rx/core/concurrency/atomic.h"
+
+#if defined(RX_PLATFORM_LINUX)
+#include "rx/core/concurrency/futex.h" // futex_{wait,wait_for,wake}
+#elif defined(RX_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h> // WaitOnAddress, WakeByAddress{Single,All}
+#else
+#include "rx/core/concurrency/yield.h" // yield
+#endif
+
+namespace rx::concurrency::detail {
+
+#if defined(RX_PLATFORM_LINUX)
+static const concurrency::atomic<rx_u32>& word(const volatile void* _address) {
+  return *reinterpret_cast<const concurrency::atomic<rx_u32>*>(const_cast<const void*>(_address));
+}
+#endif
+
+void atomic_wait(const volatile void* _address, rx_u32 _expected) {
+#if defined(RX_PLATFORM_LINUX)
+  futex_wait(word(_address), _expected);
+#elif defined(RX_PLATFORM_WINDOWS)
+  WaitOnAddress(const_cast<void*>(_address), &_expected, sizeof _expected, INFINITE);
+#else
+  // No way to sleep on an address, the caller checks the value again.
+  (void)_address;
+  (void)_expected;
+  yield();
+#endif
+}
+
+void atomic_wait_for(const volatile void* _address, rx_u32 _expected,
+  rx_u64 _nanoseconds)
+{
+#if defined(RX_PLATFORM_LINUX)
+  futex_wait_for(word(_address), _expected, _nanoseconds);
+#elif defined(RX_PLATFORM_WINDOWS)
+  // Round up so a short wait doesn't become a spin.
+  const rx_u64 milliseconds{(_nanoseconds + 999999) / 1000000};
+  WaitOnAddress(const_cast<void*>(_address), &_expected, sizeof _expected,
+    milliseconds >= INFINITE ? INFINITE - 1 : static_cast<DWORD>(milliseconds));
+#else
+  (void)_address;
+  (void)_expected;
+  (void)_nanoseconds;
+  yield();
+#endif
+}
+
+void atomic_notify(const volatile void* _address, rx_size _count) {
+#if defined(RX_PLATFORM_LINUX)
+  futex_wake(word(_address), _count);
+#elif defined(RX_PLATFORM_WINDOWS)
+  if (_count == 1) {
+    WakeByAddressSingle(const_cast<void*>(_address));
+  } else {
+    WakeByAddressAll(const_cast<void*>(_address));
+  }
+#else
+  (void)_address;
+  (void)_count;
+#endif
+}
+
+} // namespace rx::concurrency::detail
@@ -32,6 +32,29 @@ enum class memory_order {
 namespace rx::concurrency {
 
 namespace detail {
+  // Sleep while the 32-bit word at |_address| contains |_expected| or until
+  // woken by |atomic_notify|, may return spuriously.
+  void atomic_wait(const volatile void* _address, rx_u32 _expected);
+
+  // Like |atomic_wait| but gives up after |_nanoseconds|.
+  void atomic_wait_for(const volatile void* _address, rx_u32 _expected,
+    rx_u64 _nanoseconds);
+
+  // Wake at most |_count| threads sleeping in |atomic_wait| on |_address|.
+  void atomic_notify(const volatile void* _address, rx_size _count);
+
+  template<typename T>
+  inline rx_u32 atomic_wait_bits(const T& _value) {
+    static_assert(sizeof(T) == sizeof(rx_u32), "only 32-bit atomics can wait");
+    rx_u32 bits;
+    auto src{reinterpret_cast<const rx_byte*>(&_value)};
+    auto dst{reinterpret_cast<rx_byte*>(&bits)};
+    for (rx_size i{0}; i < sizeof bits; i++) {
+      dst[i] = src[i];
+    }
+    return bits;
+  }
+
   template<typename T>
   struct atomic_value : atomic_base<T> {
     atomic_value() = default;
@@ -82,41 +105,90 @@ namespace detail {
     bool compare_exchange_weak(T& expected_, T _value, memory_order _success,
       memory_order _failure) volatile
     {
-      return atomic_compare_exchange_weak(&m_value, expected_, _value, _success, _failure);
+      return atomic_compare_exchange_weak(&m_value, &expected_, _value, _success, _failure);
     }
 
     bool compare_exchange_weak(T& expected_, T _value, memory_order _success,
       memory_order _failure)
     {
-      return atomic_compare_exchange_weak(&m_value, expected_, _value, _success, _failure);
+      return atomic_compare_exchange_weak(&m_value, &expected_, _value, _success, _failure);
     }
 
     bool compare_exchange_strong(T& expected_, T _value, memory_order _success,
       memory_order _failure) volatile
     {
-      return atomic_compare_exchange_strong(&m_value, expected_, _value, _success, _failure);
+      return atomic_compare_exchange_strong(&m_value, &expected_, _value, _success, _failure);
     }
 
     bool compare_exchange_strong(T& expected_, T _value, memory_order _success,
       memory_order _failure)
     {
-      return atomic_compare_exchange_strong(&m_value, expected_, _value, _success, _failure);
+      return atomic_compare_exchange_strong(&m_value, &expected_, _value, _success, _failure);
     }
 
     bool compare_exchange_weak(T& expected_, T _value, memory_order _order = memory_order::k_seq_cst) volatile {
-      return atomic_compare_exchange_weak(&m_value, expected_, _value, _order, _order);
+      return atomic_compare_exchange_weak(&m_value, &expected_, _value, _order, _order);
     }
 
     bool compare_exchange_weak(T& expected_, T _value, memory_order _order = memory_order::k_seq_cst) {
-      return atomic_compare_exchange_weak(&m_value, expected_, _value, _order, _order);
+      return atomic_compare_exchange_weak(&m_value, &expected_, _value, _order, _order);
     }
 
     bool compare_exchange_strong(T& expected_, T _value, memory_order _order) volatile {
-      return atomic_compare_exchange_strong(&m_value, expected_, _value, _order, _order);
+      return atomic_compare_exchange_strong(&m_value, &expected_, _value, _order, _order);
     }
 
     bool compare_exchange_strong(T& expected_, T _value, memory_order _order) {
-      return atomic_compare_exchange_strong(&m_value, expected_, _value, _order, _order);
+      return atomic_compare_exchange_strong(&m_value, &expected_, _value, _order, _order);
+    }
+
+    // Block until the value is no longer |_old|. Only 32-bit atomics can
+    // wait, the calling thread sleeps in the kernel where supported.
+    void wait(T _old, memory_order _order = memory_order::k_seq_cst) const volatile {
+      while (load(_order) == _old) {
+        atomic_wait(&m_value, atomic_wait_bits(_old));
+      }
+    }
+
+    void wait(T _old, memory_order _order = memory_order::k_seq_cst) const {
+      while (load(_order) == _old) {
+        atomic_wait(&m_value, atomic_wait_bits(_old));
+      }
+    }
+
+    // Block while the value is |_old| for at most |_nanoseconds|. Unlike |wait|
+    // this may return spuriously, the caller checks the value and the time.
+    void wait_for(T _old, rx_u64 _nanoseconds,
+      memory_order _order = memory_order::k_seq_cst) const volatile
+    {
+      if (load(_order) == _old) {
+        atomic_wait_for(&m_value, atomic_wait_bits(_old), _nanoseconds);
+      }
+    }
+
+    void wait_for(T _old, rx_u64 _nanoseconds,
+      memory_order _order = memory_order::k_seq_cst) const
+    {
+      if (load(_order) == _old) {
+        atomic_wait_for(&m_value, atomic_wait_bits(_old), _nanoseconds);
+      }
+    }
+
+    // Wake one or all threads blocked in |wait| or |wait_for|.
+    void notify_one() volatile {
+      atomic_notify(&m_value, 1);
+    }
+
+    void notify_one() {
+      atomic_notify(&m_value, 1);
+    }
+
+    void notify_all() volatile {
+      atomic_notify(&m_value, -1_z);
+    }
+
+    void notify_all() {
+      atomic_notify(&m_value, -1_z);
     }
 
   protected:
@@ -151,7 +223,7 @@ namespace detail {
     }
 
     T fetch_and(T _pattern, memory_order _order = memory_order::k_seq_cst) {
-      return atomic_fetch_sub(&this->m_value, _pattern, _order);
+      return atomic_fetch_and(&this->m_value, _pattern, _order);
     }
 
     T fetch_or(T _pattern, memory_order _order = memory_order::k_seq_cst) volatile {
@@ -345,6 +417,12 @@ struct atomic<T*> : detail::atomic<T*> {
   }
 };
 
+// order memory operations around the fence without an associated atomic
+// operation
+inline void atomic_thread_fence(memory_order _order) {
+  detail::atomic_thread_fence(_order);
+}
+
 struct atomic_flag {
   atomic_flag() = default;
   constexpr atomic_flag(bool _value) : m_value{_value} {}
@@ -0,0 +1,39 @@
+#include "rx/core/concurrency/barrier.h"
+
+#include "rx/core/assert.h"
+
+namespace rx::concurrency {
+
+void barrier::arrive_and_wait() {
+  const rx_u32 phase{arrive()};
+  while (m_phase.load(memory_order::k_acquire) == phase) {
+    m_phase.wait(phase, memory_order::k_acquire);
+  }
+}
+
+void barrier::arrive_and_drop() {
+  // Lowered before arriving so the last thread of the phase sees it.
+  m_count.fetch_sub(1, memory_order::k_relaxed);
+  arrive();
+}
+
+rx_u32 barrier::arrive() {
+  // Nobody can start the next phase before this thread arrived, the phase
+  // read here is the one being arrived in.
+  const rx_u32 phase{m_phase.load(memory_order::k_acquire)};
+  const rx_u32 remaining{m_remaining.fetch_sub(1, memory_order::k_acq_rel)};
+  RX_ASSERT(remaining, "too many threads arrived");
+
+  if (remaining == 1) {
+    if (m_completion) {
+      m_completion();
+    }
+    m_remaining.store(m_count.load(memory_order::k_relaxed), memory_order::k_relaxed);
+    m_phase.store(phase + 1, memory_order::k_release);
+    m_phase.notify_all();
+  }
+
+  return phase;
+}
+
+} // namespace rx::concurrency
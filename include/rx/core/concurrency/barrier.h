@@ -0,0 +1,53 @@
+#ifndef RX_CORE_CONCURRENCY_BARRIER_H
+#define RX_CORE_CONCURRENCY_BARRIER_H
+#include "rx/core/function.h"
+
+#include "rx/core/concurrency/atomic.h"
+
+namespace rx::concurrency {
+
+// # Barrier
+//
+// Reusable barrier for |_count| threads. Threads arriving at the barrier wait
+// until every thread arrived, which completes the phase and starts the next
+// one. The last thread to arrive calls the completion function, if any, before
+// releasing the others.
+//
+// Arriving is lock-free, threads wait by sleeping on the phase number which
+// only the last thread to arrive changes and wakes them on.
+struct barrier {
+  barrier(rx_u32 _count, function<void()>&& completion_);
+  barrier(rx_u32 _count);
+
+  // arrive and wait for the other threads to arrive
+  void arrive_and_wait();
+
+  // arrive and leave, lowering the count for the following phases by one
+  void arrive_and_drop();
+
+private:
+  // Returns the phase the calling thread arrived in.
+  rx_u32 arrive();
+
+  atomic<rx_u32> m_count;     // threads taking part in the next phase
+  atomic<rx_u32> m_remaining; // threads yet to arrive in this phase
+  atomic<rx_u32> m_phase;
+  function<void()> m_completion;
+};
+
+inline barrier::barrier(rx_u32 _count, function<void()>&& completion_)
+  : m_count{_count}
+  , m_remaining{_count}
+  , m_phase{0}
+  , m_completion{utility::move(completion_)}
+{
+}
+
+inline barrier::barrier(rx_u32 _count)
+  : barrier{_count, {}}
+{
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_BARRIER_H
@@ -0,0 +1,160 @@
+#ifndef RX_CORE_CONCURRENCY_BOUNDED_QUEUE_H
+#define RX_CORE_CONCURRENCY_BOUNDED_QUEUE_H
+#include "rx/core/assert.h"
+#include "rx/core/ref.h"
+
+#include "rx/core/concurrency/atomic.h"
+#include "rx/core/concurrency/cache_line.h"
+
+#include "rx/core/memory/system_allocator.h"
+
+#include "rx/core/traits/is_trivially_copyable.h"
+
+#include "rx/core/hints/empty_bases.h"
+#include "rx/core/hints/likely.h"
+
+namespace rx::concurrency {
+
+// # Bounded Queue
+//
+// Lock-free, multi-producer, multi-consumer FIFO queue of fixed capacity.
+//
+// Every cell in the ring carries a sequence number which tells producers and
+// consumers whether the cell is ready to be written or read for the current
+// lap around the ring. Producers and consumers only contend on their own
+// position counter with a single compare-and-swap, never on a lock.
+//
+// The capacity must be a power of two and |T| must be trivially copyable.
+template<typename T>
+struct RX_HINT_EMPTY_BASES bounded_queue
+  : concepts::no_copy
+  , concepts::no_move
+{
+  static_assert(traits::is_trivially_copyable<T>,
+    "T must be trivially copyable");
+
+  bounded_queue(memory::allocator& _allocator, rx_size _capacity);
+  bounded_queue(rx_size _capacity);
+  ~bounded_queue();
+
+  // Enqueue |_value|, returns false when the queue is full.
+  bool push(const T& _value);
+
+  // Dequeue into |value_|, returns false when the queue is empty.
+  bool pop(T& value_);
+
+  rx_size capacity() const;
+
+  constexpr memory::allocator& allocator() const;
+
+private:
+  struct cell {
+    atomic<rx_size> sequence;
+    T value;
+  };
+
+  ref<memory::allocator> m_allocator;
+  cell* m_cells;
+  rx_size m_mask;
+
+  // Keep the producer and consumer positions on their own cache lines, apart
+  // from the read-only members above.
+  rx_byte m_padding0[k_cache_line];
+  atomic<rx_size> m_push_position;
+  rx_byte m_padding1[k_cache_line - sizeof(atomic<rx_size>)];
+  atomic<rx_size> m_pop_position;
+  rx_byte m_padding2[k_cache_line - sizeof(atomic<rx_size>)];
+};
+
+template<typename T>
+inline bounded_queue<T>::bounded_queue(memory::allocator& _allocator, rx_size _capacity)
+  : m_allocator{_allocator}
+  , m_cells{nullptr}
+  , m_mask{_capacity - 1}
+  , m_push_position{0}
+  , m_pop_position{0}
+{
+  RX_ASSERT(_capacity >= 2, "capacity too small");
+  RX_ASSERT((_capacity & (_capacity - 1)) == 0, "capacity not a power of two");
+
+  m_cells = reinterpret_cast<cell*>(allocator().allocate(sizeof(cell) * _capacity));
+  RX_ASSERT(m_cells, "out of memory");
+
+  for (rx_size i{0}; i < _capacity; i++) {
+    utility::construct<cell>(m_cells + i);
+    m_cells[i].sequence.store(i, memory_order::k_relaxed);
+  }
+}
+
+template<typename T>
+inline bounded_queue<T>::bounded_queue(rx_size _capacity)
+  : bounded_queue{memory::system_allocator::instance(), _capacity}
+{
+}
+
+template<typename T>
+inline bounded_queue<T>::~bounded_queue() {
+  allocator().deallocate(m_cells);
+}
+
+template<typename T>
+inline bool bounded_queue<T>::push(const T& _value) {
+  rx_size position{m_push_position.load(memory_order::k_relaxed)};
+  for (;;) {
+    cell* element{m_cells + (position & m_mask)};
+    const rx_size sequence{element->sequence.load(memory_order::k_acquire)};
+    const auto difference{static_cast<rx_ptrdiff>(sequence) - static_cast<rx_ptrdiff>(position)};
+    if (RX_HINT_LIKELY(difference == 0)) {
+      // The cell is free for this lap, try to claim it.
+      if (m_push_position.compare_exchange_weak(position, position + 1, memory_order::k_relaxed)) {
+        element->value = _value;
+        element->sequence.store(position + 1, memory_order::k_release);
+        return true;
+      }
+    } else if (difference < 0) {
+      // The cell still holds a value from the previous lap.
+      return false;
+    } else {
+      // Another producer claimed the cell, reload our position.
+      position = m_push_position.load(memory_order::k_relaxed);
+    }
+  }
+}
+
+template<typename T>
+inline bool bounded_queue<T>::pop(T& value_) {
+  rx_size position{m_pop_position.load(memory_order::k_relaxed)};
+  for (;;) {
+    cell* element{m_cells + (position & m_mask)};
+    const rx_size sequence{element->sequence.load(memory_order::k_acquire)};
+    const auto difference{static_cast<rx_ptrdiff>(sequence) - static_cast<rx_ptrdiff>(position + 1)};
+    if (RX_HINT_LIKELY(difference == 0)) {
+      // The cell holds a value for this lap, try to claim it.
+      if (m_pop_position.compare_exchange_weak(position, position + 1, memory_order::k_relaxed)) {
+        value_ = element->value;
+        element->sequence.store(position + m_mask + 1, memory_order::k_release);
+        return true;
+      }
+    } else if (difference < 0) {
+      // Nothing has been written to the cell for this lap.
+      return false;
+    } else {
+      // Another consumer claimed the cell, reload our position.
+      position = m_pop_position.load(memory_order::k_relaxed);
+    }
+  }
+}
+
+template<typename T>
+RX_HINT_FORCE_INLINE rx_size bounded_queue<T>::capacity() const {
+  return m_mask + 1;
+}
+
+template<typename T>
+RX_HINT_FORCE_INLINE constexpr memory::allocator& bounded_queue<T>::allocator() const {
+  return m_allocator;
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_BOUNDED_QUEUE_H
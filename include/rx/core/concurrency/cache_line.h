@@ -0,0 +1,14 @@
+#ifndef RX_CORE_CONCURRENCY_CACHE_LINE_H
+#define RX_CORE_CONCURRENCY_CACHE_LINE_H
+#include "rx/core/types.h"
+
+namespace rx::concurrency {
+
+// Size of a cache line on the targets we support. Data written frequently by
+// different threads should be padded and aligned to this size so it does not
+// share a cache line with other data, i.e false sharing.
+static constexpr const rx_size k_cache_line{64};
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_CACHE_LINE_H
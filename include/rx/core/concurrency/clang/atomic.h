@@ -73,34 +73,38 @@ inline T atomic_exchange(atomic_base<T>* base_, T _value, memory_order _order) {
 
 template<typename T>
 inline bool atomic_compare_exchange_strong(volatile atomic_base<T>* base_,
-  T* _expected, T _value, memory_order _order)
+  T* _expected, T _value, memory_order _success,
+  memory_order _failure)
 {
   return __c11_atomic_compare_exchange_strong(&base_->value, _expected, _value,
-    static_cast<int>(_order));
+    static_cast<int>(_success), static_cast<int>(_failure));
 }
 
 template<typename T>
 inline bool atomic_compare_exchange_strong(atomic_base<T>* base_, T* _expected,
-  T _value, memory_order _order)
+  T _value, memory_order _success,
+  memory_order _failure)
 {
   return __c11_atomic_compare_exchange_strong(&base_->value, _expected, _value,
-    static_cast<int>(_order));
+    static_cast<int>(_success), static_cast<int>(_failure));
 }
 
 template<typename T>
 inline bool atomic_compare_exchange_weak(volatile atomic_base<T>* base_,
-  T* _expected, T _value, memory_order _order)
+  T* _expected, T _value, memory_order _success,
+  memory_order _failure)
 {
   return __c11_atomic_compare_exchange_weak(&base_->value, _expected, _value,
-    static_cast<int>(_order));
+    static_cast<int>(_success), static_cast<int>(_failure));
 }
 
 template<typename T>
 inline bool atomic_compare_exchange_weak(atomic_base<T>* base_, T* _expected,
-  T _value, memory_order _order)
+  T _value, memory_order _success,
+  memory_order _failure)
 {
   return __c11_atomic_compare_exchange_weak(&base_->value, _expected, _value,
-    static_cast<int>(_order));
+    static_cast<int>(_success), static_cast<int>(_failure));
 }
 
 template<typename T>
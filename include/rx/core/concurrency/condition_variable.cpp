@@ -1,10 +1,9 @@
-
 #include "rx/core/concurrency/condition_variable.h"
-#include "rx/core/config.h" // RX_PLATFORM_{POSIX,WINDOWS}
+#include "rx/core/config.h" // RX_PLATFORM_{LINUX,WINDOWS}
 #include "rx/core/assert.h" // RX_ASSERT
 
-#if defined(RX_PLATFORM_POSIX)
-#include <pthread.h> // pthread_cond_t, pthread_cond_{init,destroy,wait,signal,broadcast}
+#if defined(RX_PLATFORM_LINUX)
+#include "rx/core/concurrency/futex.h"
 #elif defined(RX_PLATFORM_WINDOWS)
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -15,66 +14,69 @@
 
 namespace rx::concurrency {
 
-condition_variable::condition_variable() {
-#if defined(RX_PLATFORM_POSIX)
-  auto handle = reinterpret_cast<pthread_cond_t*>(m_cond);
-  if (pthread_cond_init(handle, nullptr) != 0) {
-    RX_ASSERT(false, "failed to initialize");
+#if defined(RX_PLATFORM_LINUX)
+void condition_variable::wait(mutex& _mutex) {
+  m_mutex.store(&_mutex, memory_order::k_relaxed);
+  m_waiters.fetch_add(1);
+
+  // Read the sequence number while holding the mutex, any signal after the
+  // mutex is unlocked changes it and the wait returns immediately.
+  const rx_u32 sequence{m_sequence.load()};
+  _mutex.unlock();
+  futex_wait(m_sequence, sequence);
+  m_waiters.fetch_sub(1, memory_order::k_relaxed);
+
+  // This thread may have been requeued onto the mutex along with others, lock
+  // it as contended so unlocking wakes the next one.
+  _mutex.lock_contended();
+}
+
+void condition_variable::signal() {
+  m_sequence.fetch_add(1);
+  if (m_waiters.load() != 0) {
+    futex_wake(m_sequence, 1);
   }
+}
+
+void condition_variable::broadcast() {
+  const rx_u32 sequence{m_sequence.fetch_add(1) + 1};
+  if (m_waiters.load() == 0) {
+    return;
+  }
+
+  mutex* owner{m_mutex.load(memory_order::k_relaxed)};
+  if (!futex_requeue(m_sequence, sequence, 1, owner->m_state)) {
+    // The sequence changed in the meantime, wake everyone instead.
+    futex_wake(m_sequence, -1_z);
+  }
+}
 #elif defined(RX_PLATFORM_WINDOWS)
+condition_variable::condition_variable() {
   auto handle = reinterpret_cast<CONDITION_VARIABLE*>(m_cond);
   InitializeConditionVariable(handle);
-#endif
 }
 
 condition_variable::~condition_variable() {
-#if defined(RX_PLATFORM_POSIX)
-  auto handle = reinterpret_cast<pthread_cond_t*>(m_cond);
-  if (pthread_cond_destroy(handle) != 0) {
-    RX_ASSERT(false, "failed to destroy");
-  }
-#endif
   // Windows does not require destruction of CONDITION_VARIABLE.
 }
 
-void condition_variable::wait([[maybe_unused]] mutex& _mutex) {
-#if defined(RX_PLATFORM_POSIX)
-  auto cond_handle = reinterpret_cast<pthread_cond_t*>(m_cond);
-  auto mutex_handle = reinterpret_cast<pthread_mutex_t*>(_mutex.m_mutex);
-  if (pthread_cond_wait(cond_handle, mutex_handle) != 0) {
-    RX_ASSERT(false, "failed to wait");
-  }
-#elif defined(RX_PLATFORM_WINDOWS)
+void condition_variable::wait(mutex& _mutex) {
   auto cond_handle = reinterpret_cast<CONDITION_VARIABLE*>(m_cond);
   auto mutex_handle = reinterpret_cast<CRITICAL_SECTION*>(_mutex.m_mutex);
   if (!SleepConditionVariableCS(cond_handle, mutex_handle, INFINITE)) {
     RX_ASSERT(false, "failed to wait");
   }
-#endif
 }
 
 void condition_variable::signal() {
-#if defined(RX_PLATFORM_POSIX)
-  auto handle = reinterpret_cast<pthread_cond_t*>(m_cond);
-  if (pthread_cond_signal(handle) != 0) {
-    RX_ASSERT(false, "failed to signal");
-  }
-#elif defined(RX_PLATFORM_WINDOWS)
   auto handle = reinterpret_cast<CONDITION_VARIABLE*>(m_cond);
   WakeConditionVariable(handle);
-#endif
 }
 
 void condition_variable::broadcast() {
-#if defined(RX_PLATFORM_POSIX)
-  auto handle = reinterpret_cast<pthread_cond_t*>(m_cond);
-  if (pthread_cond_broadcast(handle) != 0) {
-    RX_ASSERT(false, "failed to broadcast");
-  }
-#elif defined(RX_PLATFORM_WINDOWS)
   auto handle = reinterpret_cast<CONDITION_VARIABLE*>(m_cond);
   WakeAllConditionVariable(handle);
-#endif
 }
+#endif
 
 } // namespace rx::concurrency
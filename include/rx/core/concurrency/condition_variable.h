@@ -2,9 +2,20 @@
 #define RX_CORE_CONCURRENCY_CONDITION_VARIABLE_H
 #include "rx/core/concurrency/scope_lock.h" // scope_lock
 #include "rx/core/concurrency/mutex.h" // mutex
+#include "rx/core/concurrency/atomic.h" // atomic
 
 namespace rx::concurrency {
 
+// # Condition Variable
+//
+// On Linux the condition variable is a futex on a sequence number which every
+// signal and broadcast bumps. Waiters sleep until the sequence number changes.
+//
+// A broadcast wakes a single waiter and requeues the others onto the futex of
+// the mutex, they're woken one at a time as the mutex is unlocked instead of
+// all waking at once only to contend on the mutex.
+//
+// Other platforms use the native OS condition variable.
 struct condition_variable {
   condition_variable();
   ~condition_variable();
@@ -22,10 +33,27 @@ struct condition_variable {
   void broadcast();
 
 private:
+#if defined(RX_PLATFORM_LINUX)
+  atomic<rx_u32> m_sequence;
+  atomic<rx_u32> m_waiters;
+  atomic<mutex*> m_mutex; // mutex of the last wait, for requeueing
+#else
   // Fixed-capacity storage for any OS condition variable type, adjust if necessary.
   alignas(16) rx_byte m_cond[64];
+#endif
 };
 
+#if defined(RX_PLATFORM_LINUX)
+inline condition_variable::condition_variable()
+  : m_sequence{0}
+  , m_waiters{0}
+  , m_mutex{nullptr}
+{
+}
+
+inline condition_variable::~condition_variable() = default;
+#endif
+
 inline void condition_variable::wait(scope_lock<mutex>& _scope_lock) {
   wait(_scope_lock.m_lock);
 }
@@ -0,0 +1,40 @@
+#include "rx/core/concurrency/counting_semaphore.h"
+
+#include "rx/core/hints/likely.h"
+
+namespace rx::concurrency {
+
+void counting_semaphore::acquire() {
+  while (!try_acquire()) {
+    // Announce the wait before sleeping so that |release| either sees it and
+    // wakes this thread, or releases before the sleep checks the count.
+    m_waiters.fetch_add(1, memory_order::k_seq_cst);
+    m_count.wait(0, memory_order::k_seq_cst);
+    m_waiters.fetch_sub(1, memory_order::k_relaxed);
+  }
+}
+
+bool counting_semaphore::try_acquire() {
+  rx_u32 count{m_count.load(memory_order::k_relaxed)};
+  while (count) {
+    if (RX_HINT_LIKELY(m_count.compare_exchange_weak(count, count - 1,
+      memory_order::k_acquire, memory_order::k_relaxed)))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void counting_semaphore::release(rx_u32 _count) {
+  m_count.fetch_add(_count, memory_order::k_seq_cst);
+  if (m_waiters.load(memory_order::k_seq_cst)) {
+    if (_count == 1) {
+      m_count.notify_one();
+    } else {
+      m_count.notify_all();
+    }
+  }
+}
+
+} // namespace rx::concurrency
@@ -0,0 +1,40 @@
+#ifndef RX_CORE_CONCURRENCY_COUNTING_SEMAPHORE_H
+#define RX_CORE_CONCURRENCY_COUNTING_SEMAPHORE_H
+#include "rx/core/types.h"
+
+#include "rx/core/concurrency/atomic.h"
+
+namespace rx::concurrency {
+
+// # Counting Semaphore
+//
+// Hands out up to |_count| permits at a time. Acquiring and releasing permits
+// is lock-free while no thread has to wait, threads waiting for a permit sleep
+// on the count and releasing only enters the kernel to wake them when there
+// are any.
+struct counting_semaphore {
+  counting_semaphore(rx_u32 _count);
+
+  // take a permit, waiting for one to be released when there are none left
+  void acquire();
+
+  // take a permit if there's one left
+  bool try_acquire();
+
+  // give back |_count| permits
+  void release(rx_u32 _count = 1);
+
+private:
+  atomic<rx_u32> m_count;
+  atomic<rx_u32> m_waiters;
+};
+
+inline counting_semaphore::counting_semaphore(rx_u32 _count)
+  : m_count{_count}
+  , m_waiters{0}
+{
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_COUNTING_SEMAPHORE_H
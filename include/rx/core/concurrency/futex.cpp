@@ -0,0 +1,60 @@
+#include "rx/core/concurrency/futex.h"
+
+#if defined(RX_PLATFORM_LINUX)
+#include <errno.h> // EAGAIN
+#include <limits.h> // INT_MAX
+#include <linux/futex.h> // FUTEX_{WAIT,WAKE,CMP_REQUEUE}{,_BITSET}_PRIVATE
+#include <sys/syscall.h> // SYS_futex
+#include <time.h> // struct timespec
+#include <unistd.h> // syscall
+
+namespace rx::concurrency {
+
+static_assert(sizeof(atomic<rx_u32>) == sizeof(rx_u32),
+  "futex word must be 32 bits");
+
+static int* address(const atomic<rx_u32>& _word) {
+  return const_cast<int*>(reinterpret_cast<const int*>(&_word));
+}
+
+static int clamp(rx_size _count) {
+  return _count > INT_MAX ? INT_MAX : static_cast<int>(_count);
+}
+
+void futex_wait(const atomic<rx_u32>& _word, rx_u32 _expected) {
+  syscall(SYS_futex, address(_word), FUTEX_WAIT_PRIVATE, _expected, nullptr, nullptr, 0);
+}
+
+void futex_wait_for(const atomic<rx_u32>& _word, rx_u32 _expected, rx_u64 _nanoseconds) {
+  // The timeout of FUTEX_WAIT is relative.
+  struct timespec timeout;
+  timeout.tv_sec = static_cast<time_t>(_nanoseconds / 1000000000);
+  timeout.tv_nsec = static_cast<long>(_nanoseconds % 1000000000);
+  syscall(SYS_futex, address(_word), FUTEX_WAIT_PRIVATE, _expected, &timeout, nullptr, 0);
+}
+
+void futex_wake(const atomic<rx_u32>& _word, rx_size _count) {
+  syscall(SYS_futex, address(_word), FUTEX_WAKE_PRIVATE, clamp(_count), nullptr, nullptr, 0);
+}
+
+void futex_wait(const atomic<rx_u32>& _word, rx_u32 _expected, rx_u32 _mask) {
+  syscall(SYS_futex, address(_word), FUTEX_WAIT_BITSET_PRIVATE, _expected, nullptr, nullptr, _mask);
+}
+
+void futex_wake(const atomic<rx_u32>& _word, rx_size _count, rx_u32 _mask) {
+  syscall(SYS_futex, address(_word), FUTEX_WAKE_BITSET_PRIVATE, clamp(_count), nullptr, nullptr, _mask);
+}
+
+bool futex_requeue(const atomic<rx_u32>& _word, rx_u32 _expected, rx_size _wake,
+  const atomic<rx_u32>& target_)
+{
+  // The number of waiters to requeue is passed in place of the timeout.
+  const long result{syscall(SYS_futex, address(_word), FUTEX_CMP_REQUEUE_PRIVATE,
+    clamp(_wake), reinterpret_cast<void*>(static_cast<long>(INT_MAX)),
+    address(target_), _expected)};
+  return result >= 0 || errno != EAGAIN;
+}
+
+} // namespace rx::concurrency
+
+#endif // defined(RX_PLATFORM_LINUX)
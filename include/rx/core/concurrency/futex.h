@@ -0,0 +1,40 @@
+#ifndef RX_CORE_CONCURRENCY_FUTEX_H
+#define RX_CORE_CONCURRENCY_FUTEX_H
+#include "rx/core/concurrency/atomic.h"
+
+#if defined(RX_PLATFORM_LINUX)
+
+namespace rx::concurrency {
+
+// # Futex
+//
+// Thin wrappers around the Linux futex system call for building blocking
+// primitives on a 32-bit atomic word. Only process private futexes are used.
+
+// sleep while |_word| contains |_expected|, may return spuriously
+void futex_wait(const atomic<rx_u32>& _word, rx_u32 _expected);
+
+// sleep while |_word| contains |_expected| for at most |_nanoseconds|, may
+// return spuriously
+void futex_wait_for(const atomic<rx_u32>& _word, rx_u32 _expected, rx_u64 _nanoseconds);
+
+// wake at most |_count| threads sleeping on |_word|
+void futex_wake(const atomic<rx_u32>& _word, rx_size _count);
+
+// like the above but the sleeping thread is only woken by wakes with a
+// |_mask| sharing a bit with the one it waits with, waits without a mask match
+// every mask
+void futex_wait(const atomic<rx_u32>& _word, rx_u32 _expected, rx_u32 _mask);
+void futex_wake(const atomic<rx_u32>& _word, rx_size _count, rx_u32 _mask);
+
+// wake at most |_wake| threads sleeping on |_word| and move the rest to sleep
+// on |target_| instead, returns false without doing anything when |_word| no
+// longer contains |_expected|
+bool futex_requeue(const atomic<rx_u32>& _word, rx_u32 _expected, rx_size _wake,
+  const atomic<rx_u32>& target_);
+
+} // namespace rx::concurrency
+
+#endif // defined(RX_PLATFORM_LINUX)
+
+#endif // RX_CORE_CONCURRENCY_FUTEX_H
@@ -0,0 +1,291 @@
+#ifndef RX_CORE_CONCURRENCY_FUTURE_H
+#define RX_CORE_CONCURRENCY_FUTURE_H
+#include "rx/core/concurrency/thread_pool.h"
+#include "rx/core/concurrency/yield.h"
+
+#include "rx/core/memory/uninitialized_storage.h"
+
+#include "rx/core/traits/conditional.h"
+#include "rx/core/traits/is_void.h"
+#include "rx/core/traits/remove_cvref.h"
+
+#include "rx/core/utility/declval.h"
+#include "rx/core/utility/exchange.h"
+#include "rx/core/utility/nat.h"
+
+namespace rx::concurrency {
+
+// # Future
+//
+// The result of a job submitted to a thread pool with |thread_pool::submit|.
+//
+// The state shared by the job and the future is allocated from the pool's
+// allocator and synchronized with a single atomic status word, there is no
+// mutex or condition variable per future.
+//
+// Waiting on a future doesn't block the calling thread, instead it runs other
+// jobs of the pool until the result is ready. This keeps workers that wait on
+// the results of other jobs productive and cannot deadlock when every worker
+// is waiting.
+//
+// A continuation can be attached with |then|, it's added to the pool as a new
+// job once the result is ready and is itself represented by a future. Since
+// rex doesn't use exceptions, errors should be part of |T|, e.g optional<T>.
+template<typename T>
+struct future;
+
+namespace detail {
+  template<typename T>
+  struct future_state {
+    using value_type = traits::conditional<traits::is_void<T>, utility::nat, T>;
+
+    static constexpr const rx_u32 k_pending{0};      // no result and no continuation
+    static constexpr const rx_u32 k_continuation{1}; // no result and a continuation is stored
+    static constexpr const rx_u32 k_ready{2};        // result is stored
+
+    // Starts with two references, one for the future and one for the producer.
+    future_state(thread_pool& _pool);
+
+    template<typename... Ts>
+    void set_value(Ts&&... _value);
+    bool is_ready() const;
+
+    // Add |continuation_| to the pool once the value is ready.
+    void attach(function<void(int)>&& continuation_);
+    void release();
+
+    thread_pool& pool;
+    atomic<rx_u32> status;
+    atomic<rx_u32> references;
+    memory::uninitialized_storage<value_type> value;
+
+    // Written before |status| transitions to |k_continuation| and only read by
+    // the producer after it observed that transition.
+    function<void(int)> continuation;
+  };
+
+  // Invoke |_function| with |_arguments| and store the result in |_state|.
+  template<typename T, typename F, typename... Ts>
+  void future_fulfill(future_state<T>* _state, F& _function, Ts&&... _arguments) {
+    if constexpr (traits::is_void<T>) {
+      _function(utility::forward<Ts>(_arguments)...);
+      _state->set_value();
+    } else {
+      _state->set_value(_function(utility::forward<Ts>(_arguments)...));
+    }
+  }
+
+  template<typename F, typename T>
+  struct future_then_result {
+    using type = traits::remove_cvref<decltype(utility::declval<const F&>()(utility::declval<T>()))>;
+  };
+
+  template<typename F>
+  struct future_then_result<F, void> {
+    using type = traits::remove_cvref<decltype(utility::declval<const F&>()())>;
+  };
+} // namespace detail
+
+template<typename T>
+struct future
+  : concepts::no_copy
+{
+  constexpr future();
+  future(future&& future_);
+  ~future();
+
+  future& operator=(future&& future_);
+
+  // Run jobs of the pool on the calling thread until the result is ready.
+  void wait();
+
+  // Wait for the result and take it, the future is invalid afterwards.
+  T get();
+
+  // Invoke |_function| with the result on the pool once it's ready, the future
+  // is invalid afterwards. Returns a future for the result of |_function|.
+  template<typename F>
+  auto then(F&& _function);
+
+  bool is_valid() const;
+  bool is_ready() const;
+
+private:
+  friend struct thread_pool;
+  template<typename U>
+  friend struct future;
+
+  explicit future(detail::future_state<T>* _state);
+
+  void release();
+
+  detail::future_state<T>* m_state;
+};
+
+// detail::future_state
+template<typename T>
+inline detail::future_state<T>::future_state(thread_pool& _pool)
+  : pool{_pool}
+  , status{k_pending}
+  , references{2}
+  , continuation{_pool.allocator()}
+{
+}
+
+template<typename T>
+template<typename... Ts>
+inline void detail::future_state<T>::set_value(Ts&&... _value) {
+  value.init(utility::forward<Ts>(_value)...);
+  if (status.exchange(k_ready) == k_continuation) {
+    pool.add(utility::move(continuation));
+  }
+}
+
+template<typename T>
+inline bool detail::future_state<T>::is_ready() const {
+  return status.load(memory_order::k_acquire) == k_ready;
+}
+
+template<typename T>
+inline void detail::future_state<T>::attach(function<void(int)>&& continuation_) {
+  rx_u32 expected{k_pending};
+  if (expected != status.load(memory_order::k_acquire)) {
+    // Already ready, nothing to wait for.
+    pool.add(utility::move(continuation_));
+    return;
+  }
+
+  continuation = utility::move(continuation_);
+  if (!status.compare_exchange_strong(expected, k_continuation, memory_order::k_seq_cst)) {
+    // The value became ready in the meantime, the producer didn't observe the
+    // continuation so add it here.
+    pool.add(utility::move(continuation));
+  }
+}
+
+template<typename T>
+inline void detail::future_state<T>::release() {
+  if (references.fetch_sub(1) == 1) {
+    if (status.load(memory_order::k_relaxed) == k_ready) {
+      value.fini();
+    }
+    pool.allocator().template destroy<future_state>(this);
+  }
+}
+
+// future
+template<typename T>
+inline constexpr future<T>::future()
+  : m_state{nullptr}
+{
+}
+
+template<typename T>
+inline future<T>::future(detail::future_state<T>* _state)
+  : m_state{_state}
+{
+}
+
+template<typename T>
+inline future<T>::future(future&& future_)
+  : m_state{utility::exchange(future_.m_state, nullptr)}
+{
+}
+
+template<typename T>
+inline future<T>::~future() {
+  release();
+}
+
+template<typename T>
+inline future<T>& future<T>::operator=(future&& future_) {
+  RX_ASSERT(&future_ != this, "self assignment");
+  release();
+  m_state = utility::exchange(future_.m_state, nullptr);
+  return *this;
+}
+
+template<typename T>
+inline void future<T>::wait() {
+  RX_ASSERT(m_state, "invalid future");
+  while (!m_state->is_ready()) {
+    if (!m_state->pool.run_one()) {
+      yield();
+    }
+  }
+}
+
+template<typename T>
+inline T future<T>::get() {
+  wait();
+  if constexpr (traits::is_void<T>) {
+    release();
+  } else {
+    T result{utility::move(*m_state->value.data())};
+    release();
+    return result;
+  }
+}
+
+template<typename T>
+template<typename F>
+inline auto future<T>::then(F&& _function) {
+  RX_ASSERT(m_state, "invalid future");
+
+  using result_type = typename detail::future_then_result<F, T>::type;
+
+  auto& pool{m_state->pool};
+  auto next = pool.allocator().template create<detail::future_state<result_type>>(pool);
+  RX_ASSERT(next, "out of memory");
+
+  // The reference of this future is handed over to the continuation.
+  auto state = utility::exchange(m_state, nullptr);
+  state->attach([state, next, function = utility::forward<F>(_function)](int) {
+    if constexpr (traits::is_void<T>) {
+      detail::future_fulfill(next, function);
+    } else {
+      detail::future_fulfill(next, function, utility::move(*state->value.data()));
+    }
+    state->release();
+    next->release();
+  });
+
+  return future<result_type>{next};
+}
+
+template<typename T>
+inline bool future<T>::is_valid() const {
+  return m_state != nullptr;
+}
+
+template<typename T>
+inline bool future<T>::is_ready() const {
+  return m_state && m_state->is_ready();
+}
+
+template<typename T>
+inline void future<T>::release() {
+  if (m_state) {
+    utility::exchange(m_state, nullptr)->release();
+  }
+}
+
+// thread_pool::submit
+template<typename F>
+inline auto thread_pool::submit(F&& _function, priority _priority) {
+  using result_type = traits::remove_cvref<decltype(utility::declval<const F&>()(0))>;
+
+  auto state = allocator().create<detail::future_state<result_type>>(*this);
+  RX_ASSERT(state, "out of memory");
+
+  add([state, function = utility::forward<F>(_function)](int _thread_id) {
+    detail::future_fulfill(state, function, _thread_id);
+    state->release();
+  }, _priority);
+
+  return future<result_type>{state};
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_FUTURE_H
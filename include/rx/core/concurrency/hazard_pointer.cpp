@@ -0,0 +1,167 @@
+#include "rx/core/concurrency/hazard_pointer.h"
+#include "rx/core/concurrency/scope_lock.h"
+
+#include "rx/core/algorithm/quick_sort.h"
+
+namespace rx::concurrency {
+
+global<hazard_domain> hazard_domain::s_instance{"system", "hazard_domain"};
+
+hazard_domain::record::record(memory::allocator& _allocator)
+  : active{true}
+  , next{nullptr}
+  , retired{_allocator}
+  , protected_objects{_allocator}
+{
+  for (rx_size i{0}; i < k_hazards; i++) {
+    hazards[i].store(nullptr, memory_order::k_relaxed);
+  }
+}
+
+hazard_domain::hazard_domain(memory::allocator& _allocator)
+  : m_allocator{_allocator}
+  , m_records{nullptr}
+  , m_record_count{0}
+  , m_orphans{allocator()}
+  , m_orphan_count{0}
+{
+}
+
+hazard_domain::~hazard_domain() {
+  // Nothing can be protected anymore, destroy whatever is still retired.
+  for (record* next{m_records.load()}; next; ) {
+    record* current{next};
+    next = current->next;
+    RX_ASSERT(!current->active.load(), "participant still registered");
+    current->retired.each_fwd([](const retired_object& _object) {
+      _object.reclaim(*_object.allocator, _object.object);
+    });
+    allocator().destroy<record>(current);
+  }
+
+  m_orphans.each_fwd([](const retired_object& _object) {
+    _object.reclaim(*_object.allocator, _object.object);
+  });
+}
+
+hazard_domain::record* hazard_domain::acquire() {
+  // Reuse the record of a participant which went away.
+  for (record* next{m_records.load(memory_order::k_acquire)}; next; next = next->next) {
+    bool expected{false};
+    if (!next->active.load(memory_order::k_relaxed)
+      && next->active.compare_exchange_strong(expected, true, memory_order::k_acquire,
+        memory_order::k_relaxed))
+    {
+      return next;
+    }
+  }
+
+  auto item{allocator().create<record>(allocator())};
+  RX_ASSERT(item, "out of memory");
+
+  item->next = m_records.load(memory_order::k_relaxed);
+  while (!m_records.compare_exchange_weak(item->next, item, memory_order::k_release,
+    memory_order::k_relaxed));
+
+  m_record_count.fetch_add(1, memory_order::k_relaxed);
+  return item;
+}
+
+void hazard_domain::release(record* _record) {
+  for (rx_size i{0}; i < k_hazards; i++) {
+    _record->hazards[i].store(nullptr, memory_order::k_release);
+  }
+
+  scan(_record);
+
+  // Whatever is still protected by someone else is left to the next scan of
+  // another participant.
+  if (!_record->retired.is_empty()) {
+    scope_lock lock{m_orphans_lock};
+    _record->retired.each_fwd([this](const retired_object& _object) {
+      m_orphans.push_back(_object);
+    });
+    m_orphan_count.store(m_orphans.size(), memory_order::k_relaxed);
+    _record->retired.clear();
+  }
+
+  _record->active.store(false, memory_order::k_release);
+}
+
+void hazard_domain::retire(record* _record, const retired_object& _object) {
+  _record->retired.push_back(_object);
+
+  // Scanning once the list is twice the number of hazard pointers in the
+  // domain guarantees at least half the list is reclaimed by every scan.
+  const rx_size hazards{m_record_count.load(memory_order::k_relaxed) * k_hazards};
+  const rx_size threshold{hazards * 2 > k_scan_threshold ? hazards * 2 : k_scan_threshold};
+  if (_record->retired.size() >= threshold) {
+    scan(_record);
+  }
+}
+
+void hazard_domain::scan(record* _record) {
+  if (m_orphan_count.load(memory_order::k_relaxed)) {
+    scope_lock lock{m_orphans_lock};
+    m_orphans.each_fwd([_record](const retired_object& _object) {
+      _record->retired.push_back(_object);
+    });
+    m_orphans.clear();
+    m_orphan_count.store(0, memory_order::k_relaxed);
+  }
+
+  if (_record->retired.is_empty()) {
+    return;
+  }
+
+  // Pairs with the store and reload in |participant::protect|. Either the
+  // reader sees the object was unlinked and retries, or this scan sees the
+  // hazard pointer protecting it.
+  atomic_thread_fence(memory_order::k_seq_cst);
+
+  auto& hazards{_record->protected_objects};
+  hazards.clear();
+  for (record* next{m_records.load(memory_order::k_acquire)}; next; next = next->next) {
+    for (rx_size i{0}; i < k_hazards; i++) {
+      if (const void* object{next->hazards[i].load(memory_order::k_acquire)}) {
+        hazards.push_back(object);
+      }
+    }
+  }
+
+  const auto compare{[](const void* _lhs, const void* _rhs) {
+    return reinterpret_cast<rx_uintptr>(_lhs) < reinterpret_cast<rx_uintptr>(_rhs);
+  }};
+  if (!hazards.is_empty()) {
+    algorithm::quick_sort(hazards.data(), hazards.data() + hazards.size(), compare);
+  }
+
+  const auto is_protected{[&](const void* _object) {
+    rx_size lo{0};
+    rx_size hi{hazards.size()};
+    while (lo < hi) {
+      const rx_size mid{lo + (hi - lo) / 2};
+      if (compare(hazards[mid], _object)) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo < hazards.size() && hazards[lo] == _object;
+  }};
+
+  // Destroy everything that isn't protected and compact the rest.
+  auto& retired{_record->retired};
+  rx_size kept{0};
+  for (rx_size i{0}; i < retired.size(); i++) {
+    const retired_object object{retired[i]};
+    if (is_protected(object.object)) {
+      retired[kept++] = object;
+    } else {
+      object.reclaim(*object.allocator, object.object);
+    }
+  }
+  retired.erase(kept, retired.size());
+}
+
+} // namespace rx::concurrency
@@ -0,0 +1,206 @@
+#ifndef RX_CORE_CONCURRENCY_HAZARD_POINTER_H
+#define RX_CORE_CONCURRENCY_HAZARD_POINTER_H
+#include "rx/core/vector.h"
+#include "rx/core/global.h"
+
+#include "rx/core/concurrency/atomic.h"
+#include "rx/core/concurrency/spin_lock.h"
+
+#include "rx/core/hints/empty_bases.h"
+
+namespace rx::concurrency {
+
+// # Hazard Pointers
+//
+// Safe memory reclamation for lock-free data structures. A thread which
+// removed an object from a lock-free structure can't free it right away since
+// other threads may still be reading it, instead it retires the object to the
+// domain. The object is destroyed through the allocator it came from once no
+// thread protects it anymore.
+//
+// Threads take part through a |participant|, which owns |k_hazards| hazard
+// pointers. Reading a shared pointer with |protect| publishes it in one of
+// them, the object it points to stays alive until the hazard pointer is
+// reset or reused. Protecting a pointer costs a store and a reload of the
+// source, there are no shared counters.
+//
+// Retired objects collect in a list owned by the participant. Once that list
+// grows past twice the number of hazard pointers in the domain, or
+// |k_scan_threshold| objects when that's more, the participant scans every
+// hazard pointer and destroys the retired objects none of them points to. At
+// most one object per hazard pointer survives a scan, so a participant never
+// holds more than the scan threshold of garbage, even when other threads stall
+// while protecting something. Objects left behind by a participant going away
+// are adopted by the next participant to scan.
+//
+// Participants are registered on construction and reuse the records of
+// participants which went away, so threads can come and go cheaply. A
+// participant must only be used by the thread which created it.
+struct RX_HINT_EMPTY_BASES hazard_domain
+  : concepts::no_copy
+  , concepts::no_move
+{
+  static constexpr const rx_size k_hazards{4};
+  static constexpr const rx_size k_scan_threshold{64};
+
+  hazard_domain(memory::allocator& _allocator);
+  hazard_domain();
+
+  // every participant must be gone, objects still retired are destroyed
+  ~hazard_domain();
+
+  struct participant;
+
+  constexpr memory::allocator& allocator() const;
+
+  static constexpr hazard_domain& instance();
+
+private:
+  friend struct participant;
+
+  struct record;
+
+  using reclaim_fn = void (*)(memory::allocator&, void*);
+
+  struct retired_object {
+    void* object;
+    memory::allocator* allocator;
+    reclaim_fn reclaim;
+  };
+
+  record* acquire();
+  void release(record* _record);
+  void retire(record* _record, const retired_object& _object);
+  void scan(record* _record);
+
+  memory::allocator& m_allocator;
+
+  // Records are pushed to the front and only freed with the domain, readers
+  // walk the list without a lock.
+  atomic<record*> m_records;
+  atomic<rx_size> m_record_count;
+
+  // Objects left behind by released participants.
+  spin_lock m_orphans_lock;
+  vector<retired_object> m_orphans; // protected by |m_orphans_lock|
+  atomic<rx_size> m_orphan_count;
+
+  static global<hazard_domain> s_instance;
+};
+
+struct RX_HINT_EMPTY_BASES hazard_domain::participant
+  : concepts::no_copy
+  , concepts::no_move
+{
+  participant(hazard_domain& _domain);
+  participant();
+  ~participant();
+
+  // load |_source| and protect the object it points to with hazard pointer
+  // |_index|, the object stays alive until the hazard pointer is reset or
+  // used to protect something else
+  template<typename T>
+  T* protect(rx_size _index, const atomic<T*>& _source);
+
+  // stop protecting the object of hazard pointer |_index|
+  void reset(rx_size _index);
+
+  // destroy |_object| with |_allocator| once no hazard pointer protects it, it
+  // must already be unreachable for threads which didn't protect it yet
+  template<typename T>
+  void retire(memory::allocator& _allocator, T* _object);
+
+  // scan now, destroying every retired object which isn't protected
+  void reclaim();
+
+  constexpr hazard_domain& domain() const;
+
+private:
+  hazard_domain& m_domain;
+  record* m_record;
+};
+
+struct hazard_domain::record {
+  record(memory::allocator& _allocator);
+
+  // Written by the owning participant, read by every scan.
+  atomic<const void*> hazards[k_hazards];
+
+  atomic<bool> active;
+  record* next;
+
+  // Owned by the participant holding the record.
+  vector<retired_object> retired;
+  vector<const void*> protected_objects;
+};
+
+inline hazard_domain::hazard_domain()
+  : hazard_domain{memory::system_allocator::instance()}
+{
+}
+
+RX_HINT_FORCE_INLINE constexpr memory::allocator& hazard_domain::allocator() const {
+  return m_allocator;
+}
+
+RX_HINT_FORCE_INLINE constexpr hazard_domain& hazard_domain::instance() {
+  return *s_instance;
+}
+
+// hazard_domain::participant
+inline hazard_domain::participant::participant(hazard_domain& _domain)
+  : m_domain{_domain}
+  , m_record{_domain.acquire()}
+{
+}
+
+inline hazard_domain::participant::participant()
+  : participant{hazard_domain::instance()}
+{
+}
+
+inline hazard_domain::participant::~participant() {
+  m_domain.release(m_record);
+}
+
+template<typename T>
+inline T* hazard_domain::participant::protect(rx_size _index, const atomic<T*>& _source) {
+  RX_ASSERT(_index < k_hazards, "out of bounds");
+  auto& hazard{m_record->hazards[_index]};
+
+  // The object may be retired and scanned between loading the pointer and
+  // publishing it, only a reload after publishing proves it wasn't.
+  T* pointer{_source.load(memory_order::k_acquire)};
+  for (;;) {
+    hazard.store(pointer, memory_order::k_seq_cst);
+    T* current{_source.load(memory_order::k_seq_cst)};
+    if (current == pointer) {
+      return pointer;
+    }
+    pointer = current;
+  }
+}
+
+inline void hazard_domain::participant::reset(rx_size _index) {
+  RX_ASSERT(_index < k_hazards, "out of bounds");
+  m_record->hazards[_index].store(nullptr, memory_order::k_release);
+}
+
+template<typename T>
+inline void hazard_domain::participant::retire(memory::allocator& _allocator, T* _object) {
+  m_domain.retire(m_record, {_object, &_allocator, [](memory::allocator& allocator_, void* _data) {
+    allocator_.destroy<T>(_data);
+  }});
+}
+
+inline void hazard_domain::participant::reclaim() {
+  m_domain.scan(m_record);
+}
+
+RX_HINT_FORCE_INLINE constexpr hazard_domain& hazard_domain::participant::domain() const {
+  return m_domain;
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_HAZARD_POINTER_H
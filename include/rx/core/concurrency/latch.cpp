@@ -0,0 +1,28 @@
+#include "rx/core/concurrency/latch.h"
+
+#include "rx/core/assert.h"
+
+namespace rx::concurrency {
+
+void latch::count_down(rx_u32 _count) {
+  const rx_u32 count{m_count.fetch_sub(_count, memory_order::k_acq_rel)};
+  RX_ASSERT(count >= _count, "counted down too far");
+  if (count == _count) {
+    m_count.notify_all();
+  }
+}
+
+void latch::arrive_and_wait(rx_u32 _count) {
+  count_down(_count);
+  wait();
+}
+
+void latch::wait() const {
+  for (rx_u32 count{m_count.load(memory_order::k_acquire)}; count;
+    count = m_count.load(memory_order::k_acquire))
+  {
+    m_count.wait(count, memory_order::k_acquire);
+  }
+}
+
+} // namespace rx::concurrency
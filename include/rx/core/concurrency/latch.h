@@ -0,0 +1,44 @@
+#ifndef RX_CORE_CONCURRENCY_LATCH_H
+#define RX_CORE_CONCURRENCY_LATCH_H
+#include "rx/core/types.h"
+
+#include "rx/core/concurrency/atomic.h"
+
+namespace rx::concurrency {
+
+// # Latch
+//
+// Single use barrier. The latch is counted down from |_count| by any thread,
+// threads waiting for it are released once the count reaches zero and cannot
+// be raised again. Counting down is lock-free, only the thread which counts
+// down to zero wakes the waiting threads.
+struct latch {
+  latch(rx_u32 _count);
+
+  // lower the count by |_count|
+  void count_down(rx_u32 _count = 1);
+
+  // lower the count by |_count| and wait for it to reach zero
+  void arrive_and_wait(rx_u32 _count = 1);
+
+  // check if the count reached zero without waiting
+  bool try_wait() const;
+
+  void wait() const;
+
+private:
+  atomic<rx_u32> m_count;
+};
+
+inline latch::latch(rx_u32 _count)
+  : m_count{_count}
+{
+}
+
+inline bool latch::try_wait() const {
+  return m_count.load(memory_order::k_acquire) == 0;
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_LATCH_H
@@ -0,0 +1,59 @@
+#ifndef RX_CORE_CONCURRENCY_LOCK_STATS_H
+#define RX_CORE_CONCURRENCY_LOCK_STATS_H
+#include "rx/core/concurrency/atomic.h"
+
+namespace rx::concurrency {
+
+// # Lock Statistics
+//
+// Contention counters of a spinning lock. The counters are only maintained
+// when built with RX_LOCK_STATS, otherwise they always read as zero and cost
+// nothing.
+struct lock_stats {
+  rx_u64 acquires;  // number of times the lock was acquired
+  rx_u64 contended; // acquires which found the lock held
+  rx_u64 spins;     // pause instructions executed waiting for the lock
+  rx_u64 yields;    // time slices given up waiting for the lock
+};
+
+namespace detail {
+  struct lock_counters {
+    constexpr lock_counters();
+
+    lock_stats stats() const;
+
+    atomic<rx_u64> acquires;
+    atomic<rx_u64> contended;
+    atomic<rx_u64> spins;
+    atomic<rx_u64> yields;
+  };
+
+  inline constexpr lock_counters::lock_counters()
+    : acquires{0}
+    , contended{0}
+    , spins{0}
+    , yields{0}
+  {
+  }
+
+  inline lock_stats lock_counters::stats() const {
+    return {
+      acquires.load(memory_order::k_relaxed),
+      contended.load(memory_order::k_relaxed),
+      spins.load(memory_order::k_relaxed),
+      yields.load(memory_order::k_relaxed)
+    };
+  }
+} // namespace detail
+
+#if defined(RX_LOCK_STATS)
+#define RX_LOCK_STAT(_counters, _counter, _amount) \
+  (_counters)._counter.fetch_add((_amount), ::rx::concurrency::memory_order::k_relaxed)
+#else
+#define RX_LOCK_STAT(_counters, _counter, _amount) \
+  static_cast<void>(0)
+#endif
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_LOCK_STATS_H
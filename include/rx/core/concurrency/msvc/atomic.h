@@ -80,23 +80,23 @@ namespace rx::concurrency::detail {
     }
 
     template <typename T>
-    inline bool atomic_compare_exchange_strong(volatile atomic_base<T>* base_, T* _expected, T _value, memory_order _order) {
-        return base_->compare_exchange_strong(_value, to_memory_order(_order));
+    inline bool atomic_compare_exchange_strong(volatile atomic_base<T>* base_, T* _expected, T _value, memory_order _success, memory_order _failure) {
+        return base_->compare_exchange_strong(*_expected, _value, to_memory_order(_success), to_memory_order(_failure));
     }
 
     template <typename T>
-    inline bool atomic_compare_exchange_strong(atomic_base<T>* base_, T* _expected, T _value, memory_order _order) {
-        return base_->compare_exchange_strong(_value, to_memory_order(_order));
+    inline bool atomic_compare_exchange_strong(atomic_base<T>* base_, T* _expected, T _value, memory_order _success, memory_order _failure) {
+        return base_->compare_exchange_strong(*_expected, _value, to_memory_order(_success), to_memory_order(_failure));
     }
 
     template <typename T>
-    inline bool atomic_compare_exchange_weak(volatile atomic_base<T>* base_, T* _expected, T _value, memory_order _order) {
-        return base_->compare_exchange_weak(_value, to_memory_order(_order));
+    inline bool atomic_compare_exchange_weak(volatile atomic_base<T>* base_, T* _expected, T _value, memory_order _success, memory_order _failure) {
+        return base_->compare_exchange_weak(*_expected, _value, to_memory_order(_success), to_memory_order(_failure));
     }
 
     template <typename T>
-    inline bool atomic_compare_exchange_weak(atomic_base<T>* base_, T* _expected, T _value, memory_order _order) {
-        return base_->compare_exchange_weak(_value, to_memory_order(_order));
+    inline bool atomic_compare_exchange_weak(atomic_base<T>* base_, T* _expected, T _value, memory_order _success, memory_order _failure) {
+        return base_->compare_exchange_weak(*_expected, _value, to_memory_order(_success), to_memory_order(_failure));
     }
 
     template <typename T>
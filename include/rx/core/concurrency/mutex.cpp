@@ -1,9 +1,12 @@
 #include "rx/core/concurrency/mutex.h"
-#include "rx/core/config.h" // RX_PLATFORM_{POSIX,WINDOWS}
+#include "rx/core/config.h" // RX_PLATFORM_{LINUX,WINDOWS}
 #include "rx/core/assert.h"
 
-#if defined(RX_PLATFORM_POSIX)
-#include <pthread.h> // pthread_mutex_t, pthread_mutex_{init,destroy,lock,unlock}
+#if defined(RX_PLATFORM_LINUX)
+#include "rx/core/concurrency/futex.h"
+#include "rx/core/concurrency/yield.h"
+
+#include "rx/core/hints/likely.h"
 #elif defined(RX_PLATFORM_WINDOWS)
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -14,52 +17,65 @@
 
 namespace rx::concurrency {
 
-mutex::mutex() {
-#if defined(RX_PLATFORM_POSIX)
-  auto handle = reinterpret_cast<pthread_mutex_t*>(m_mutex);
-  if (pthread_mutex_init(handle, nullptr) != 0) {
-    RX_ASSERT(false, "initialization failed");
+#if defined(RX_PLATFORM_LINUX)
+// Number of times to check the mutex before sleeping.
+static constexpr const int k_spin_count{100};
+
+void mutex::lock() {
+  rx_u32 expected{k_unlocked};
+  if (RX_HINT_LIKELY(m_state.compare_exchange_strong(expected, k_locked,
+    memory_order::k_acquire, memory_order::k_relaxed)))
+  {
+    return;
+  }
+
+  // Spin while the holder is likely to release it soon.
+  for (int i{0}; i < k_spin_count && expected == k_locked; i++) {
+    pause();
+    expected = m_state.load(memory_order::k_relaxed);
+    if (expected == k_unlocked && m_state.compare_exchange_strong(expected,
+      k_locked, memory_order::k_acquire, memory_order::k_relaxed))
+    {
+      return;
+    }
+  }
+
+  lock_contended();
+}
+
+void mutex::lock_contended() {
+  // Acquire the mutex as contended since it's unknown whether other threads
+  // are sleeping, so the unlock wakes them.
+  while (m_state.exchange(k_contended, memory_order::k_acquire) != k_unlocked) {
+    futex_wait(m_state, k_contended);
+  }
+}
+
+void mutex::unlock() {
+  if (m_state.exchange(k_unlocked, memory_order::k_release) == k_contended) {
+    futex_wake(m_state, 1);
   }
+}
 #elif defined(RX_PLATFORM_WINDOWS)
+mutex::mutex() {
   auto handle = reinterpret_cast<CRITICAL_SECTION*>(m_mutex);
   InitializeCriticalSection(handle);
-#endif
 }
 
 mutex::~mutex() {
-#if defined(RX_PLATFORM_POSIX)
-  auto handle = reinterpret_cast<pthread_mutex_t*>(m_mutex);
-  if (pthread_mutex_destroy(handle) != 0) {
-    RX_ASSERT(false, "destroy failed");
-  }
-#elif defined(RX_PLATFORM_WINDOWS)
   auto handle = reinterpret_cast<CRITICAL_SECTION*>(m_mutex);
   DeleteCriticalSection(handle);
-#endif
 }
 
 void mutex::lock() {
-#if defined(RX_PLATFORM_POSIX)
-  auto handle = reinterpret_cast<pthread_mutex_t*>(m_mutex);
-  if (pthread_mutex_lock(handle) != 0) {
-    RX_ASSERT(false, "lock failed");
-  }
-#elif defined(RX_PLATFORM_WINDOWS)
   auto handle = reinterpret_cast<CRITICAL_SECTION*>(m_mutex);
   EnterCriticalSection(handle);
-#endif
 }
 
 void mutex::unlock() {
-#if defined(RX_PLATFORM_POSIX)
-  auto handle = reinterpret_cast<pthread_mutex_t*>(m_mutex);
-  if (pthread_mutex_unlock(handle) != 0) {
-    RX_ASSERT(false, "unlock failed");
-  }
-#elif defined(RX_PLATFORM_WINDOWS)
   auto handle = reinterpret_cast<CRITICAL_SECTION*>(m_mutex);
   LeaveCriticalSection(handle);
-#endif
 }
+#endif
 
 } // namespace rx::concurrency
@@ -1,9 +1,26 @@
 #ifndef RX_CORE_CONCURRENCY_MUTEX_H
 #define RX_CORE_CONCURRENCY_MUTEX_H
 #include "rx/core/types.h" // rx_byte
+#include "rx/core/config.h" // RX_PLATFORM_LINUX
+
+#if defined(RX_PLATFORM_LINUX)
+#include "rx/core/concurrency/atomic.h"
+#endif
 
 namespace rx::concurrency {
 
+// # Mutex
+//
+// On Linux the mutex is a single 32-bit word operated on in user-space, the
+// kernel is only entered through a futex when a thread has to sleep or wake a
+// sleeping thread. Locking and unlocking without contention is a single atomic
+// operation each.
+//
+// A thread which finds the mutex locked spins for a short while before going
+// to sleep, but only while no other thread is sleeping on it already, since a
+// queue of sleeping threads means the mutex is held for long.
+//
+// Other platforms use the native OS mutex.
 struct mutex {
   mutex();
   ~mutex();
@@ -14,10 +31,31 @@ struct mutex {
 private:
   friend struct condition_variable;
 
+#if defined(RX_PLATFORM_LINUX)
+  enum : rx_u32 {
+    k_unlocked,
+    k_locked,   // locked without sleeping threads
+    k_contended // locked, threads may be sleeping
+  };
+
+  void lock_contended();
+
+  atomic<rx_u32> m_state;
+#else
   // Fixed-capacity storage for any OS mutex type, adjust if necessary.
   alignas(16) rx_byte m_mutex[64];
+#endif
 };
 
+#if defined(RX_PLATFORM_LINUX)
+inline mutex::mutex()
+  : m_state{k_unlocked}
+{
+}
+
+inline mutex::~mutex() = default;
+#endif
+
 } // namespace rx::concurrency
 
 #endif // RX_CORE_CONCURRENCY_MUTEX_H
@@ -0,0 +1,45 @@
+#include "rx/core/concurrency/numa_thread_pool.h"
+
+namespace rx::concurrency {
+
+numa_thread_pool::numa_thread_pool(memory::allocator& _allocator, rx_size _static_pool_size)
+  : m_allocator{_allocator}
+  , m_topology{allocator()}
+  , m_pools{allocator()}
+  , m_next{0}
+{
+  vector<rx_size> affinity{allocator()};
+  const bool restore{topology::affinity(affinity)};
+
+  m_topology.nodes().each_fwd([&](const topology::node& _node) {
+    topology::set_affinity(_node.cpus);
+    auto pool{allocator().create<thread_pool>(allocator(), _node.cpus, _static_pool_size)};
+    RX_ASSERT(pool, "out of memory");
+    m_pools.push_back(pool);
+  });
+
+  if (restore) {
+    topology::set_affinity(affinity);
+  }
+}
+
+numa_thread_pool::~numa_thread_pool() {
+  m_pools.each_fwd([this](thread_pool* _pool) {
+    allocator().destroy<thread_pool>(_pool);
+  });
+}
+
+thread_pool& numa_thread_pool::pool_of(const void* _data) {
+  // Finding the node of |_data| is a syscall, skip it when there's one node.
+  if (m_pools.size() == 1) {
+    return *m_pools[0];
+  }
+
+  const rx_size node{m_topology.node_of(_data)};
+  if (node != -1_z) {
+    return *m_pools[node];
+  }
+  return *m_pools[m_next.fetch_add(1, memory_order::k_relaxed) % m_pools.size()];
+}
+
+} // namespace rx::concurrency
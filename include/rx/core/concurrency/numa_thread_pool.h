@@ -0,0 +1,84 @@
+#ifndef RX_CORE_CONCURRENCY_NUMA_THREAD_POOL_H
+#define RX_CORE_CONCURRENCY_NUMA_THREAD_POOL_H
+#include "rx/core/concurrency/thread_pool.h"
+#include "rx/core/concurrency/topology.h"
+
+namespace rx::concurrency {
+
+// # NUMA Thread Pool
+//
+// A thread pool per NUMA node of the machine. The workers of each sub-pool are
+// pinned to the logical cores of their node.
+//
+// Memory is placed on the node of the thread that first touches it, so every
+// sub-pool is constructed while the constructing thread is pinned to the node,
+// which keeps the job slots and queues of the sub-pool in node-local memory.
+//
+// Jobs operating on a piece of data should be added with |add| which routes
+// them to the sub-pool of the node the data resides on, so the job accesses it
+// without crossing the socket interconnect.
+//
+// On machines with a single node this is a single pool with pinned workers.
+struct RX_HINT_EMPTY_BASES numa_thread_pool
+  : concepts::no_copy
+  , concepts::no_move
+{
+  numa_thread_pool(memory::allocator& _allocator, rx_size _static_pool_size);
+  numa_thread_pool(rx_size _static_pool_size);
+  ~numa_thread_pool();
+
+  // add |task_| to the sub-pool of the node the memory at |_data| resides on,
+  // jobs for memory on an unknown node are distributed round-robin
+  void add(const void* _data, function<void(int)>&& task_,
+    thread_pool::priority _priority = thread_pool::priority::k_normal);
+
+  // the sub-pool of the node the memory at |_data| resides on
+  thread_pool& pool_of(const void* _data);
+
+  // the sub-pool of the node at index |_node| in |machine().nodes()|
+  thread_pool& pool(rx_size _node) const;
+  rx_size pool_count() const;
+
+  const topology& machine() const;
+
+  constexpr memory::allocator& allocator() const;
+
+private:
+  ref<memory::allocator> m_allocator;
+  topology m_topology;
+  vector<thread_pool*> m_pools;
+
+  // Round-robin index for jobs on memory of an unknown node.
+  atomic<rx_size> m_next;
+};
+
+inline numa_thread_pool::numa_thread_pool(rx_size _static_pool_size)
+  : numa_thread_pool{memory::system_allocator::instance(), _static_pool_size}
+{
+}
+
+inline void numa_thread_pool::add(const void* _data, function<void(int)>&& task_,
+  thread_pool::priority _priority)
+{
+  pool_of(_data).add(utility::move(task_), _priority);
+}
+
+inline thread_pool& numa_thread_pool::pool(rx_size _node) const {
+  return *m_pools[_node];
+}
+
+inline rx_size numa_thread_pool::pool_count() const {
+  return m_pools.size();
+}
+
+inline const topology& numa_thread_pool::machine() const {
+  return m_topology;
+}
+
+RX_HINT_FORCE_INLINE constexpr memory::allocator& numa_thread_pool::allocator() const {
+  return m_allocator;
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_NUMA_THREAD_POOL_H
@@ -0,0 +1,110 @@
+#include "rx/core/concurrency/parallel_for.h"
+#include "rx/core/concurrency/scope_lock.h"
+
+#include "rx/core/algorithm/max.h"
+#include "rx/core/algorithm/min.h"
+
+namespace rx::concurrency::detail {
+
+parallel_state::parallel_state(memory::allocator& _allocator, rx_size _begin,
+  rx_size _end, rx_size _grain, rx_size _participants,
+  participate_fn _participate, void* _context)
+  : m_allocator{_allocator}
+  , m_participate{_participate}
+  , m_context{_context}
+  , m_end{_end}
+  , m_grain{_grain}
+  , m_participants{_participants}
+  , m_next{_begin}
+  , m_remaining{_end - _begin}
+  , m_references{_participants}
+  , m_done{false}
+{
+}
+
+bool parallel_state::claim(rx_size& begin_, rx_size& end_) {
+  rx_size begin{m_next.load(memory_order::k_relaxed)};
+  while (begin < m_end) {
+    // Guided scheduling: take a share of what remains, bounded below by the
+    // grain so chunks never get too small to amortize the claim.
+    const rx_size remaining{m_end - begin};
+    const rx_size size{algorithm::min(remaining,
+      algorithm::max(m_grain, remaining / (m_participants * 2)))};
+    if (m_next.compare_exchange_weak(begin, begin + size, memory_order::k_relaxed)) {
+      begin_ = begin;
+      end_ = begin + size;
+      return true;
+    }
+  }
+  return false;
+}
+
+void parallel_state::participate() {
+  // Only touch |m_context| once a chunk has been claimed, helpers which start
+  // after the range is exhausted may outlive the caller's context.
+  rx_size begin;
+  rx_size end;
+  if (claim(begin, end)) {
+    complete(m_participate(m_context, *this, begin, end));
+  }
+}
+
+void parallel_state::complete(rx_size _processed) {
+  if (m_remaining.fetch_sub(_processed) == _processed) {
+    scope_lock lock{m_mutex};
+    m_done = true;
+    m_done_cond.signal();
+  }
+}
+
+void parallel_state::wait() {
+  if (m_remaining.load() == 0) {
+    return;
+  }
+  scope_lock lock{m_mutex};
+  m_done_cond.wait(lock, [this] { return m_done; });
+}
+
+void parallel_state::release() {
+  if (m_references.fetch_sub(1) == 1) {
+    m_allocator.destroy<parallel_state>(this);
+  }
+}
+
+void parallel_run(thread_pool& _pool, rx_size _begin, rx_size _end,
+  rx_size _grain, parallel_state::participate_fn _participate, void* _context)
+{
+  if (_begin >= _end) {
+    return;
+  }
+
+  const rx_size grain{algorithm::max(_grain, 1_z)};
+  const rx_size chunks{(_end - _begin + grain - 1) / grain};
+  const rx_size helpers{algorithm::min(_pool.thread_count(), chunks - 1)};
+
+  // Nothing to split, run it all on the calling thread.
+  if (helpers == 0) {
+    parallel_state state{_pool.allocator(), _end, _end, grain, 1, _participate, _context};
+    _participate(_context, state, _begin, _end);
+    return;
+  }
+
+  // The state is reference counted since helper jobs may only get to run after
+  // every index has been processed and this function returned.
+  auto state = _pool.allocator().create<parallel_state>(_pool.allocator(),
+    _begin, _end, grain, helpers + 1, _participate, _context);
+  RX_ASSERT(state, "out of memory");
+
+  for (rx_size i{0}; i < helpers; i++) {
+    _pool.add([state](int) {
+      state->participate();
+      state->release();
+    });
+  }
+
+  state->participate();
+  state->wait();
+  state->release();
+}
+
+} // namespace rx::concurrency::detail
@@ -0,0 +1,110 @@
+#ifndef RX_CORE_CONCURRENCY_PARALLEL_FOR_H
+#define RX_CORE_CONCURRENCY_PARALLEL_FOR_H
+#include "rx/core/concurrency/thread_pool.h"
+
+#include "rx/core/traits/remove_reference.h"
+
+namespace rx::concurrency {
+
+// # Parallel For
+//
+// Invokes |_function(index)| for every index in [_begin, _end) on the workers
+// of |_pool| and the calling thread, returning once every index is processed.
+//
+// The range is split adaptively. Each participant claims a chunk proportional
+// to the remaining work divided among the participants, but never smaller than
+// |_grain| indices. Early chunks are large and later chunks shrink so the tail
+// balances out across workers.
+//
+// A single job is added to the pool per participating worker regardless of how
+// many chunks the range splits into, the calling thread processes chunks too.
+template<typename F>
+void parallel_for(thread_pool& _pool, rx_size _begin, rx_size _end,
+  rx_size _grain, F&& _function);
+
+// Same as above on |thread_pool::instance()|.
+template<typename F>
+void parallel_for(rx_size _begin, rx_size _end, rx_size _grain, F&& _function);
+
+namespace detail {
+  // Type-erased state shared by the participants of a parallel loop.
+  struct parallel_state {
+    // Processes the claimed chunk [_begin, _end) and every chunk claimed after
+    // it from |_state|, returns the number of indices processed.
+    using participate_fn = rx_size (*)(void* _context, parallel_state& _state,
+      rx_size _begin, rx_size _end);
+
+    parallel_state(memory::allocator& _allocator, rx_size _begin, rx_size _end,
+      rx_size _grain, rx_size _participants, participate_fn _participate,
+      void* _context);
+
+    // Claim the next chunk, returns false when the range is exhausted.
+    bool claim(rx_size& begin_, rx_size& end_);
+
+  private:
+    friend void parallel_run(thread_pool& _pool, rx_size _begin, rx_size _end,
+      rx_size _grain, participate_fn _participate, void* _context);
+
+    void participate();
+    void complete(rx_size _processed);
+    void wait();
+    void release();
+
+    memory::allocator& m_allocator;
+    participate_fn m_participate;
+    void* m_context;
+    rx_size m_end;
+    rx_size m_grain;
+    rx_size m_participants;
+
+    atomic<rx_size> m_next;       // next unclaimed index
+    atomic<rx_size> m_remaining;  // indices not yet processed
+    atomic<rx_size> m_references; // caller and outstanding helper jobs
+
+    mutex m_mutex;
+    condition_variable m_done_cond;
+    bool m_done; // protected by |m_mutex|
+  };
+
+  // Runs |_participate| over [_begin, _end) on |_pool| and the calling thread.
+  //
+  // |_context| is only accessed by participants that claimed a chunk, all of
+  // which complete before this returns, so it may live on the caller's stack.
+  void parallel_run(thread_pool& _pool, rx_size _begin, rx_size _end,
+    rx_size _grain, parallel_state::participate_fn _participate, void* _context);
+
+  template<typename F>
+  rx_size parallel_for_participate(void* _context, parallel_state& _state,
+    rx_size _begin, rx_size _end)
+  {
+    auto& function{*reinterpret_cast<F*>(_context)};
+    rx_size processed{0};
+    do {
+      for (rx_size i{_begin}; i < _end; i++) {
+        function(i);
+      }
+      processed += _end - _begin;
+    } while (_state.claim(_begin, _end));
+    return processed;
+  }
+} // namespace detail
+
+template<typename F>
+inline void parallel_for(thread_pool& _pool, rx_size _begin, rx_size _end,
+  rx_size _grain, F&& _function)
+{
+  using function_type = traits::remove_reference<F>;
+  detail::parallel_run(_pool, _begin, _end, _grain,
+    &detail::parallel_for_participate<function_type>,
+    const_cast<void*>(static_cast<const void*>(&_function)));
+}
+
+template<typename F>
+inline void parallel_for(rx_size _begin, rx_size _end, rx_size _grain, F&& _function) {
+  parallel_for(thread_pool::instance(), _begin, _end, _grain,
+    utility::forward<F>(_function));
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_PARALLEL_FOR_H
@@ -0,0 +1,87 @@
+#ifndef RX_CORE_CONCURRENCY_PARALLEL_REDUCE_H
+#define RX_CORE_CONCURRENCY_PARALLEL_REDUCE_H
+#include "rx/core/concurrency/parallel_for.h"
+#include "rx/core/concurrency/spin_lock.h"
+#include "rx/core/concurrency/scope_lock.h"
+
+namespace rx::concurrency {
+
+// # Parallel Reduce
+//
+// Maps every index in [_begin, _end) with |_map(index)| and combines the
+// results with |_reduce(a, b)|, starting from |_identity|. The work is split
+// and scheduled exactly like |parallel_for|.
+//
+// Every participant reduces the chunks it processes into a local value and
+// only combines that with the shared result once, when it runs out of chunks.
+// The order participants combine in is unspecified, |_reduce| must be both
+// associative and commutative.
+template<typename T, typename M, typename R>
+T parallel_reduce(thread_pool& _pool, rx_size _begin, rx_size _end,
+  rx_size _grain, const T& _identity, M&& _map, R&& _reduce);
+
+// Same as above on |thread_pool::instance()|.
+template<typename T, typename M, typename R>
+T parallel_reduce(rx_size _begin, rx_size _end, rx_size _grain,
+  const T& _identity, M&& _map, R&& _reduce);
+
+namespace detail {
+  template<typename T, typename M, typename R>
+  struct parallel_reduce_context {
+    const T& identity;
+    M& map;
+    R& reduce;
+    spin_lock lock;
+    T result; // protected by |lock|
+  };
+
+  template<typename C>
+  rx_size parallel_reduce_participate(void* _context, parallel_state& _state,
+    rx_size _begin, rx_size _end)
+  {
+    auto& context{*reinterpret_cast<C*>(_context)};
+    auto local{context.identity};
+    rx_size processed{0};
+    do {
+      for (rx_size i{_begin}; i < _end; i++) {
+        local = context.reduce(local, context.map(i));
+      }
+      processed += _end - _begin;
+    } while (_state.claim(_begin, _end));
+
+    // Combine before reporting the indices as processed so the result is
+    // complete by the time the caller observes every index as processed.
+    {
+      scope_lock lock{context.lock};
+      context.result = context.reduce(context.result, local);
+    }
+
+    return processed;
+  }
+} // namespace detail
+
+template<typename T, typename M, typename R>
+inline T parallel_reduce(thread_pool& _pool, rx_size _begin, rx_size _end,
+  rx_size _grain, const T& _identity, M&& _map, R&& _reduce)
+{
+  using context_type = detail::parallel_reduce_context<T,
+    traits::remove_reference<M>, traits::remove_reference<R>>;
+
+  context_type context{_identity, _map, _reduce, {}, _identity};
+  detail::parallel_run(_pool, _begin, _end, _grain,
+    &detail::parallel_reduce_participate<context_type>, &context);
+
+  return utility::move(context.result);
+}
+
+template<typename T, typename M, typename R>
+inline T parallel_reduce(rx_size _begin, rx_size _end, rx_size _grain,
+  const T& _identity, M&& _map, R&& _reduce)
+{
+  return parallel_reduce(thread_pool::instance(), _begin, _end, _grain,
+    _identity, utility::forward<M>(_map), utility::forward<R>(_reduce));
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_PARALLEL_REDUCE_H
@@ -0,0 +1,144 @@
+#include "rx/core/concurrency/rw_lock.h"
+#include "rx/core/concurrency/yield.h" // yield, pause
+
+#include "rx/core/hints/likely.h"
+#include "rx/core/hints/unlikely.h"
+
+#if defined(RX_PLATFORM_LINUX)
+#include "rx/core/concurrency/futex.h"
+#endif
+
+namespace rx::concurrency {
+
+// Number of times a writer checks for readers before sleeping.
+static constexpr const int k_spin_count{100};
+
+// Threads are spread over the reader slots in the order they first take a
+// shared lock, a thread uses the same slot for every lock.
+static atomic<rx_size> g_next_slot{0};
+static thread_local rx_size t_slot{-1_z};
+
+static rx_size reader_slot() {
+  if (RX_HINT_UNLIKELY(t_slot == -1_z)) {
+    t_slot = g_next_slot.fetch_add(1, memory_order::k_relaxed) % rw_lock::k_reader_slots;
+  }
+  return t_slot;
+}
+
+static void wait(const atomic<rx_u32>& _word, rx_u32 _expected) {
+#if defined(RX_PLATFORM_LINUX)
+  futex_wait(_word, _expected);
+#else
+  if (_word.load(memory_order::k_relaxed) == _expected) {
+    yield();
+  }
+#endif
+}
+
+static void wake(const atomic<rx_u32>& _word, rx_size _count) {
+#if defined(RX_PLATFORM_LINUX)
+  futex_wake(_word, _count);
+#else
+  (void)_word;
+  (void)_count;
+#endif
+}
+
+rw_lock::rw_lock()
+  : m_writer{k_unlocked}
+  , m_pending_writers{0}
+  , m_drained{0}
+{
+  for (rx_size i{0}; i < k_reader_slots; i++) {
+    m_slots[i].readers.store(0, memory_order::k_relaxed);
+  }
+}
+
+void rw_lock::lock() {
+  m_pending_writers.fetch_add(1, memory_order::k_relaxed);
+  m_writers.lock();
+  m_pending_writers.fetch_sub(1, memory_order::k_relaxed);
+
+  // The previous writer may have left the state set for this one, keep it
+  // contended when readers sleep on it.
+  rx_u32 expected{k_unlocked};
+  m_writer.compare_exchange_strong(expected, k_locked, memory_order::k_seq_cst,
+    memory_order::k_seq_cst);
+
+  // Wait for the readers which got in before the state was set. The count of
+  // readers leaving is read first so none can leave unnoticed before sleeping.
+  for (int i{0}; ; i++) {
+    const rx_u32 drained{m_drained.load(memory_order::k_seq_cst)};
+    if (!has_readers()) {
+      break;
+    }
+    if (i < k_spin_count) {
+      pause();
+    } else {
+      wait(m_drained, drained);
+    }
+  }
+}
+
+void rw_lock::unlock() {
+  // Hand the lock directly to the next writer without letting readers in.
+  if (m_pending_writers.load(memory_order::k_seq_cst) == 0
+    && m_writer.exchange(k_unlocked, memory_order::k_seq_cst) == k_contended)
+  {
+    wake(m_writer, -1_z);
+  }
+  m_writers.unlock();
+}
+
+void rw_lock::lock_shared() {
+  auto& readers{m_slots[reader_slot()].readers};
+  for (;;) {
+    readers.fetch_add(1, memory_order::k_seq_cst);
+    if (RX_HINT_LIKELY(m_writer.load(memory_order::k_seq_cst) == k_unlocked)) {
+      return;
+    }
+
+    // Step aside so the writer isn't kept waiting on this reader.
+    readers.fetch_sub(1, memory_order::k_seq_cst);
+    signal_writer();
+    wait_for_writer();
+  }
+}
+
+void rw_lock::unlock_shared() {
+  m_slots[reader_slot()].readers.fetch_sub(1, memory_order::k_seq_cst);
+  if (RX_HINT_UNLIKELY(m_writer.load(memory_order::k_seq_cst) != k_unlocked)) {
+    signal_writer();
+  }
+}
+
+bool rw_lock::has_readers() const {
+  for (rx_size i{0}; i < k_reader_slots; i++) {
+    if (m_slots[i].readers.load(memory_order::k_seq_cst)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void rw_lock::wait_for_writer() {
+  for (rx_u32 state{m_writer.load(memory_order::k_relaxed)};
+    state != k_unlocked; state = m_writer.load(memory_order::k_relaxed))
+  {
+    // Mark the state contended so the writer wakes the sleeping readers. When
+    // the exchange fails because the writer left, the wait returns right away.
+    if (state == k_locked) {
+      m_writer.compare_exchange_strong(state, k_contended,
+        memory_order::k_relaxed, memory_order::k_relaxed);
+    }
+    wait(m_writer, k_contended);
+  }
+}
+
+void rw_lock::signal_writer() {
+  // Only one writer waits for readers at a time.
+  m_drained.fetch_add(1, memory_order::k_seq_cst);
+  wake(m_drained, 1);
+}
+
+} // namespace rx::concurrency
@@ -0,0 +1,74 @@
+#ifndef RX_CORE_CONCURRENCY_RW_LOCK_H
+#define RX_CORE_CONCURRENCY_RW_LOCK_H
+#include "rx/core/concurrency/atomic.h"
+#include "rx/core/concurrency/mutex.h"
+#include "rx/core/concurrency/cache_line.h"
+
+namespace rx::concurrency {
+
+// # Reader-Writer Lock
+//
+// Shared lock for read-mostly state. Any number of readers can hold the lock
+// at once with |lock_shared|, while a writer holding it with |lock| excludes
+// everyone else.
+//
+// Readers don't share a reader count. Each thread counts itself in one of
+// |k_reader_slots| counters, each on its own cache line. An uncontended read
+// lock writes only that line and reads the writer state, which stays shared in
+// every reader's cache until a writer arrives. Readers scale across cores as a
+// result, at the cost of a lock taking |k_reader_slots| cache lines.
+//
+// Writers are preferred. Once a writer arrives, new readers step aside and
+// wait for it, the writer only waits for the readers already inside. Readers
+// can starve under a constant stream of writers.
+//
+// On Linux waiting threads sleep on a futex, on other platforms they yield.
+//
+// The lock is not recursive, a reader taking the lock again while a writer
+// waits deadlocks. A shared lock must be released by the thread which took it.
+struct rw_lock {
+  static constexpr const rx_size k_reader_slots{16};
+
+  rw_lock();
+  ~rw_lock() = default;
+
+  // exclusive access, use with |scope_lock|
+  void lock();
+  void unlock();
+
+  // shared access, use with |scope_shared_lock|
+  void lock_shared();
+  void unlock_shared();
+
+private:
+  enum : rx_u32 {
+    k_unlocked,
+    k_locked,   // a writer holds or waits for the lock
+    k_contended // as above and readers may be sleeping
+  };
+
+  bool has_readers() const;
+  void wait_for_writer();
+  void signal_writer();
+
+  struct slot {
+    atomic<rx_u32> readers;
+    rx_byte padding[k_cache_line - sizeof(atomic<rx_u32>)];
+  };
+
+  // Written by writers only, read by every reader.
+  atomic<rx_u32> m_writer;
+  atomic<rx_u32> m_pending_writers;
+  mutex m_writers;
+  rx_byte m_padding0[k_cache_line];
+
+  // Bumped by readers leaving while a writer waits for them.
+  atomic<rx_u32> m_drained;
+  rx_byte m_padding1[k_cache_line - sizeof(atomic<rx_u32>)];
+
+  slot m_slots[k_reader_slots];
+};
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_RW_LOCK_H
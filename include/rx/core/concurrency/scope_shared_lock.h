@@ -0,0 +1,29 @@
+#ifndef RX_CORE_CONCURRENCY_SCOPE_SHARED_LOCK_H
+#define RX_CORE_CONCURRENCY_SCOPE_SHARED_LOCK_H
+
+namespace rx::concurrency {
+
+// generic scoped shared lock
+template<typename T>
+struct scope_shared_lock {
+  explicit constexpr scope_shared_lock(T& lock_);
+  ~scope_shared_lock();
+private:
+  T& m_lock;
+};
+
+template<typename T>
+inline constexpr scope_shared_lock<T>::scope_shared_lock(T& lock_)
+  : m_lock{lock_}
+{
+  m_lock.lock_shared();
+}
+
+template<typename T>
+inline scope_shared_lock<T>::~scope_shared_lock() {
+  m_lock.unlock_shared();
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_SCOPE_SHARED_LOCK_H
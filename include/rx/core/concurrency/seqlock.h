@@ -0,0 +1,161 @@
+#ifndef RX_CORE_CONCURRENCY_SEQLOCK_H
+#define RX_CORE_CONCURRENCY_SEQLOCK_H
+#include "rx/core/concurrency/atomic.h"
+#include "rx/core/concurrency/spin_lock.h"
+#include "rx/core/concurrency/yield.h" // pause
+
+#include "rx/core/traits/is_trivially_copyable.h"
+
+#include "rx/core/hints/likely.h"
+
+#include "rx/core/assert.h"
+
+namespace rx::concurrency {
+
+// # Sequence Lock
+//
+// Holds a small trivially copyable value, e.g a vector, which is read far
+// more often than it's written. Readers never write to the lock, they copy the
+// value and retry when a writer changed it during the copy. Readers don't
+// slow each other or the writer down but a reader can be kept retrying by a
+// constant stream of writers.
+//
+// Writers are serialized with a spin lock and make the sequence number odd for
+// the duration of the write. Either use |store| or hold the lock for a write
+// section with |scope_lock| and use |read| and |write| in the section, e.g to
+// modify the value in place.
+//
+// The value is stored as machine words accessed atomically, which keeps the
+// copy of a reader racing a writer well defined.
+template<typename T>
+struct seqlock {
+  static_assert(traits::is_trivially_copyable<T>,
+    "seqlock requires trivially copyable type");
+
+  seqlock();
+  seqlock(const T& _value);
+
+  // a consistent copy of the value
+  T load() const;
+
+  // replace the value
+  void store(const T& _value);
+
+  // exclusive write section, use with |scope_lock|
+  void lock();
+  void unlock();
+
+  // access the value in a write section
+  T read() const;
+  void write(const T& _value);
+
+private:
+  static constexpr const rx_size k_words{(sizeof(T) + sizeof(rx_uintptr) - 1) / sizeof(rx_uintptr)};
+
+  static void copy(void* dst_, const void* _src, rx_size _size);
+
+  void write_words(const T& _value);
+
+  atomic<rx_u32> m_sequence;
+  spin_lock m_lock;
+  atomic<rx_uintptr> m_words[k_words];
+};
+
+template<typename T>
+inline seqlock<T>::seqlock()
+  : seqlock{T{}}
+{
+}
+
+template<typename T>
+inline seqlock<T>::seqlock(const T& _value)
+  : m_sequence{0}
+{
+  write_words(_value);
+}
+
+template<typename T>
+inline T seqlock<T>::load() const {
+  rx_uintptr words[k_words];
+  for (;;) {
+    const rx_u32 sequence{m_sequence.load(memory_order::k_acquire)};
+    if (RX_HINT_LIKELY(!(sequence & 1))) {
+      for (rx_size i{0}; i < k_words; i++) {
+        words[i] = m_words[i].load(memory_order::k_relaxed);
+      }
+
+      // The copy must complete before the sequence is checked again.
+      atomic_thread_fence(memory_order::k_acquire);
+      if (RX_HINT_LIKELY(m_sequence.load(memory_order::k_relaxed) == sequence)) {
+        break;
+      }
+    }
+    pause();
+  }
+
+  T result;
+  copy(&result, words, sizeof(T));
+  return result;
+}
+
+template<typename T>
+inline void seqlock<T>::store(const T& _value) {
+  lock();
+  write(_value);
+  unlock();
+}
+
+template<typename T>
+inline void seqlock<T>::lock() {
+  m_lock.lock();
+  m_sequence.store(m_sequence.load(memory_order::k_relaxed) + 1, memory_order::k_relaxed);
+
+  // The odd sequence must be visible before any of the words change.
+  atomic_thread_fence(memory_order::k_release);
+}
+
+template<typename T>
+inline void seqlock<T>::unlock() {
+  m_sequence.store(m_sequence.load(memory_order::k_relaxed) + 1, memory_order::k_release);
+  m_lock.unlock();
+}
+
+template<typename T>
+inline T seqlock<T>::read() const {
+  RX_ASSERT(m_sequence.load(memory_order::k_relaxed) & 1, "not in write section");
+  rx_uintptr words[k_words];
+  for (rx_size i{0}; i < k_words; i++) {
+    words[i] = m_words[i].load(memory_order::k_relaxed);
+  }
+  T result;
+  copy(&result, words, sizeof(T));
+  return result;
+}
+
+template<typename T>
+inline void seqlock<T>::write(const T& _value) {
+  RX_ASSERT(m_sequence.load(memory_order::k_relaxed) & 1, "not in write section");
+  write_words(_value);
+}
+
+template<typename T>
+inline void seqlock<T>::write_words(const T& _value) {
+  rx_uintptr words[k_words]{};
+  copy(words, &_value, sizeof(T));
+  for (rx_size i{0}; i < k_words; i++) {
+    m_words[i].store(words[i], memory_order::k_relaxed);
+  }
+}
+
+template<typename T>
+inline void seqlock<T>::copy(void* dst_, const void* _src, rx_size _size) {
+  auto dst{reinterpret_cast<rx_byte*>(dst_)};
+  auto src{reinterpret_cast<const rx_byte*>(_src)};
+  for (rx_size i{0}; i < _size; i++) {
+    dst[i] = src[i];
+  }
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_SEQLOCK_H
@@ -1,5 +1,8 @@
 #include "rx/core/concurrency/spin_lock.h" // spin_lock
-#include "rx/core/concurrency/yield.h" // yield
+#include "rx/core/concurrency/yield.h" // yield, pause
+#include "rx/core/concurrency/futex.h" // futex_wait, futex_wake
+
+#include "rx/core/hints/likely.h"
 
 // ThreadSanitizer annotations
 #if defined(RX_TSAN)
@@ -17,31 +20,123 @@ extern "C"
 
 namespace rx::concurrency {
 
+// Bounds for the exponential backoff, in pause instructions.
+static constexpr const rx_u32 k_min_backoff{1};
+static constexpr const rx_u32 k_max_backoff{64};
+
+// Number of pause instructions the next ticket lock waiter executes between
+// checks of it's ticket.
+static constexpr const rx_u32 k_ticket_backoff{32};
+
+// Number of times the next ticket lock waiter checks it's ticket before it
+// starts to sleep between checks.
+static constexpr const rx_u32 k_ticket_spins{64};
+
+#if defined(RX_PLATFORM_LINUX)
+// Sleeping ticket lock waiters are woken by the mask of their ticket so that an
+// unlock only wakes the thread it serves, unless more than 32 threads wait.
+static inline rx_u32 ticket_mask(rx_u32 _ticket) {
+  return 1_u32 << (_ticket & 31);
+}
+#endif
+
+// spin_lock
 void spin_lock::lock() {
   tsan_acquire(&m_lock);
+  RX_LOCK_STAT(m_counters, acquires, 1);
 
   // fast path, always succeeds within a single thread
-  if (!m_lock.test_and_set(memory_order::k_acquire)) {
+  if (RX_HINT_LIKELY(!m_lock.exchange(true, memory_order::k_acquire))) {
     return;
   }
 
-  // fixed busy loop
-  int count{100};
-  while (count--) {
-    if (!m_lock.test_and_set(memory_order::k_acquire)) {
-      return;
+  lock_contended();
+}
+
+void spin_lock::lock_contended() {
+  RX_LOCK_STAT(m_counters, contended, 1);
+
+  rx_u32 backoff{k_min_backoff};
+  for (;;) {
+    // Wait for the lock to look free without writing to it.
+    while (m_lock.load(memory_order::k_relaxed)) {
+      if (backoff < k_max_backoff) {
+        for (rx_u32 i{0}; i < backoff; i++) {
+          pause();
+        }
+        RX_LOCK_STAT(m_counters, spins, backoff);
+        backoff <<= 1;
+      } else {
+        // The holder isn't releasing it, it may not be running.
+        yield();
+        RX_LOCK_STAT(m_counters, yields, 1);
+      }
     }
-  }
 
-  // blocking loop
-  while (m_lock.test_and_set(memory_order::k_acquire)) {
-    yield();
+    if (!m_lock.exchange(true, memory_order::k_acquire)) {
+      return;
+    }
   }
 }
 
 void spin_lock::unlock() {
-  m_lock.clear(memory_order::k_release);
+  m_lock.store(false, memory_order::k_release);
   tsan_release(&m_lock);
 }
 
+// ticket_lock
+void ticket_lock::lock() {
+  tsan_acquire(&m_serving);
+  RX_LOCK_STAT(m_counters, acquires, 1);
+
+  const rx_u32 ticket{m_next.fetch_add(1, memory_order::k_relaxed)};
+  rx_u32 serving{m_serving.load(memory_order::k_acquire)};
+  if (RX_HINT_LIKELY(serving == ticket)) {
+    return;
+  }
+
+  RX_LOCK_STAT(m_counters, contended, 1);
+
+  for (rx_u32 checks{0}; serving != ticket; checks++) {
+    // Only the next thread in line spins, the ones behind it cannot get the
+    // lock before it so they give up the processor to the holder or to the
+    // threads ahead of them.
+    if (ticket - serving == 1 && checks < k_ticket_spins) {
+      for (rx_u32 i{0}; i < k_ticket_backoff; i++) {
+        pause();
+      }
+      RX_LOCK_STAT(m_counters, spins, k_ticket_backoff);
+    } else {
+#if defined(RX_PLATFORM_LINUX)
+      // Yielding is not enough when there are more threads than cores, the
+      // scheduler keeps picking the yielding threads over the preempted ones
+      // they wait on. Sleep until woken by the unlock serving this ticket.
+      m_sleepers.fetch_add(1, memory_order::k_seq_cst);
+      futex_wait(m_serving, serving, ticket_mask(ticket));
+      m_sleepers.fetch_sub(1, memory_order::k_relaxed);
+#else
+      yield();
+#endif
+      RX_LOCK_STAT(m_counters, yields, 1);
+    }
+    serving = m_serving.load(memory_order::k_acquire);
+  }
+}
+
+void ticket_lock::unlock() {
+  // Only the holder writes |m_serving|.
+#if defined(RX_PLATFORM_LINUX)
+  // The store and the load of |m_sleepers| must not be reordered, a waiter
+  // either sees the new ticket before it sleeps or is seen here and woken.
+  const rx_u32 serving{m_serving.load(memory_order::k_relaxed) + 1};
+  m_serving.store(serving, memory_order::k_seq_cst);
+  if (m_sleepers.load(memory_order::k_seq_cst)) {
+    futex_wake(m_serving, -1_z, ticket_mask(serving));
+  }
+#else
+  m_serving.store(m_serving.load(memory_order::k_relaxed) + 1, memory_order::k_release);
+#endif
+  tsan_release(&m_serving);
+}
+
 } // namespace rx::concurrency
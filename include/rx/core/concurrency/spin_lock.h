@@ -1,16 +1,67 @@
 #ifndef RX_CORE_CONCURRENCY_SPIN_LOCK_H
 #define RX_CORE_CONCURRENCY_SPIN_LOCK_H
-#include "rx/core/concurrency/atomic.h" // atomic_flag
+#include "rx/core/concurrency/atomic.h" // atomic
+#include "rx/core/concurrency/lock_stats.h" // lock_stats
 
 namespace rx::concurrency {
 
+// # Spin Lock
+//
+// Test-and-test-and-set lock. Waiting threads spin on a plain load of the lock,
+// which stays in their cache, rather than on the exchange, which would bounce
+// the cache line between them. Every failed attempt doubles the number of pause
+// instructions executed before checking again, up to a limit after which the
+// thread yields it's time slice to the holder instead.
+//
+// The lock is not fair, use |ticket_lock| for highly contended locks where
+// waiting threads must acquire the lock in order.
 struct spin_lock {
   constexpr spin_lock();
   ~spin_lock() = default;
+
   void lock();
   void unlock();
+
+  // contention statistics, only maintained when built with RX_LOCK_STATS
+  lock_stats stats() const;
+
 private:
-  atomic_flag m_lock;
+  void lock_contended();
+
+  atomic<bool> m_lock;
+#if defined(RX_LOCK_STATS)
+  detail::lock_counters m_counters;
+#endif
+};
+
+// # Ticket Lock
+//
+// Fair spin lock. Every thread takes a ticket and waits until the ticket is
+// served, threads acquire the lock in the order they arrived and none can
+// starve. Only the thread next in line spins, the threads behind it yield or,
+// on Linux, sleep on a futex until their ticket is served.
+//
+// Fairness comes at a cost when there are more threads than cores, a thread
+// which is preempted while next in line holds up every thread behind it.
+struct ticket_lock {
+  constexpr ticket_lock();
+  ~ticket_lock() = default;
+
+  void lock();
+  void unlock();
+
+  // contention statistics, only maintained when built with RX_LOCK_STATS
+  lock_stats stats() const;
+
+private:
+  atomic<rx_u32> m_next;
+  atomic<rx_u32> m_serving;
+#if defined(RX_PLATFORM_LINUX)
+  atomic<rx_u32> m_sleepers;
+#endif
+#if defined(RX_LOCK_STATS)
+  detail::lock_counters m_counters;
+#endif
 };
 
 inline constexpr spin_lock::spin_lock()
@@ -18,6 +69,31 @@ inline constexpr spin_lock::spin_lock()
 {
 }
 
+inline lock_stats spin_lock::stats() const {
+#if defined(RX_LOCK_STATS)
+  return m_counters.stats();
+#else
+  return {0, 0, 0, 0};
+#endif
+}
+
+inline constexpr ticket_lock::ticket_lock()
+  : m_next{0}
+  , m_serving{0}
+#if defined(RX_PLATFORM_LINUX)
+  , m_sleepers{0}
+#endif
+{
+}
+
+inline lock_stats ticket_lock::stats() const {
+#if defined(RX_LOCK_STATS)
+  return m_counters.stats();
+#else
+  return {0, 0, 0, 0};
+#endif
+}
+
 } // namespace rx::concurrency
 
 #endif // RX_CORE_CONCURRENCY_SPIN_LOCK_H
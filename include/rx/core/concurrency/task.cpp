@@ -0,0 +1,99 @@
+#include "rx/core/concurrency/task.h"
+
+#if defined(__cpp_impl_coroutine)
+#include "rx/core/concurrency/bounded_queue.h"
+
+#include "rx/core/global.h"
+
+namespace rx::concurrency::detail {
+
+// Frames are rounded up to a multiple of |k_granularity| bytes and recycled
+// through a lock-free queue per size. Larger frames go to the allocator.
+static constexpr const rx_size k_granularity{64};
+static constexpr const rx_size k_size_classes{16};
+static constexpr const rx_size k_frames_per_class{64};
+
+struct RX_HINT_EMPTY_BASES task_frame_pool
+  : concepts::no_copy
+  , concepts::no_move
+{
+  task_frame_pool(memory::allocator& _allocator);
+  task_frame_pool();
+  ~task_frame_pool();
+
+  void* allocate(rx_size _size);
+  void deallocate(void* _data, rx_size _size);
+
+  constexpr memory::allocator& allocator() const;
+
+private:
+  using free_list = bounded_queue<void*>;
+
+  ref<memory::allocator> m_allocator;
+  memory::uninitialized_storage<free_list> m_free_lists[k_size_classes];
+};
+
+task_frame_pool::task_frame_pool(memory::allocator& _allocator)
+  : m_allocator{_allocator}
+{
+  for (rx_size i{0}; i < k_size_classes; i++) {
+    m_free_lists[i].init(allocator(), k_frames_per_class);
+  }
+}
+
+task_frame_pool::task_frame_pool()
+  : task_frame_pool{memory::system_allocator::instance()}
+{
+}
+
+task_frame_pool::~task_frame_pool() {
+  for (rx_size i{0}; i < k_size_classes; i++) {
+    auto& free_list{*m_free_lists[i].data()};
+    void* frame;
+    while (free_list.pop(frame)) {
+      allocator().deallocate(frame);
+    }
+    m_free_lists[i].fini();
+  }
+}
+
+void* task_frame_pool::allocate(rx_size _size) {
+  const rx_size size_class{(_size + k_granularity - 1) / k_granularity - 1};
+  if (size_class >= k_size_classes) {
+    return allocator().allocate(_size);
+  }
+
+  void* frame;
+  if (m_free_lists[size_class].data()->pop(frame)) {
+    return frame;
+  }
+
+  return allocator().allocate((size_class + 1) * k_granularity);
+}
+
+void task_frame_pool::deallocate(void* _data, rx_size _size) {
+  const rx_size size_class{(_size + k_granularity - 1) / k_granularity - 1};
+  if (size_class >= k_size_classes || !m_free_lists[size_class].data()->push(_data)) {
+    allocator().deallocate(_data);
+  }
+}
+
+RX_HINT_FORCE_INLINE constexpr memory::allocator& task_frame_pool::allocator() const {
+  return m_allocator;
+}
+
+static global<task_frame_pool> g_frame_pool{"system", "task_frame_pool"};
+
+void* task_allocate(rx_size _size) {
+  void* frame{g_frame_pool->allocate(_size)};
+  RX_ASSERT(frame, "out of memory");
+  return frame;
+}
+
+void task_deallocate(void* _data, rx_size _size) {
+  g_frame_pool->deallocate(_data, _size);
+}
+
+} // namespace rx::concurrency::detail
+
+#endif // defined(__cpp_impl_coroutine)
@@ -0,0 +1,325 @@
+#ifndef RX_CORE_CONCURRENCY_TASK_H
+#define RX_CORE_CONCURRENCY_TASK_H
+#include "rx/core/concurrency/future.h"
+
+#include "rx/core/time/span.h"
+
+#include "rx/core/abort.h"
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine> // std::coroutine_handle, std::noop_coroutine, std::suspend_{always,never}
+
+namespace rx::concurrency {
+
+// # Task
+//
+// A coroutine returning |T| which runs on a thread pool. Requires C++20, the
+// contents of this header are only available when coroutines are enabled.
+//
+// Tasks start lazily, a task only runs once it's awaited by another task with
+// |co_await| or handed to |thread_pool::spawn|. Awaiting a task runs it on the
+// awaiting thread and resumes the awaiting task right after it completes,
+// without going through the pool.
+//
+// Tasks never block a worker. Awaiting something that isn't ready, like an
+// |async_counter|, suspends the task and the worker returns to the pool to run
+// other jobs. The task is added back to the pool as a job once it can resume.
+// Tasks can also move themselves onto a pool with |co_await schedule(pool)|,
+// or sleep without blocking a worker with |co_await schedule_after(pool, span)|.
+//
+// Coroutine frames come from a pool of recycled, size classed blocks instead of
+// the general heap, so spawning short lived tasks doesn't allocate in steady
+// state.
+//
+// Rex doesn't use exceptions, a task that throws aborts.
+template<typename T = void>
+struct task;
+
+namespace detail {
+  // Allocate and deallocate coroutine frames from the frame pool.
+  void* task_allocate(rx_size _size);
+  void task_deallocate(void* _data, rx_size _size);
+
+  struct task_promise_base {
+    struct final_awaiter {
+      bool await_ready() const noexcept { return false; }
+
+      // Resume whatever awaited the task on this thread, if anything.
+      template<typename P>
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<P> _handle) noexcept {
+        if (auto continuation = _handle.promise().continuation) {
+          return continuation;
+        }
+        return std::noop_coroutine();
+      }
+
+      void await_resume() const noexcept {}
+    };
+
+    static void* operator new(rx_size _size) {
+      return task_allocate(_size);
+    }
+
+    static void operator delete(void* _data, rx_size _size) {
+      task_deallocate(_data, _size);
+    }
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() const {
+      abort("unhandled exception in task");
+    }
+
+    std::coroutine_handle<> continuation;
+  };
+
+  template<typename T>
+  struct task_promise : task_promise_base {
+    task_promise();
+    ~task_promise();
+
+    task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U&& _value);
+
+    T&& result();
+
+  private:
+    memory::uninitialized_storage<T> m_value;
+    bool m_has_value;
+  };
+
+  template<>
+  struct task_promise<void> : task_promise_base {
+    task<void> get_return_object();
+    void return_void() const {}
+    void result() const {}
+  };
+
+  // Eagerly started coroutine which destroys itself once it completes, used to
+  // run a task to completion for |thread_pool::spawn|.
+  struct task_detached {
+    struct promise_type : task_promise_base {
+      task_detached get_return_object() const { return {}; }
+      std::suspend_never initial_suspend() const noexcept { return {}; }
+      std::suspend_never final_suspend() const noexcept { return {}; }
+      void return_void() const {}
+    };
+  };
+
+  template<typename T>
+  task_detached task_run(thread_pool& _pool, thread_pool::priority _priority,
+    task<T> _task, future_state<T>* _state);
+} // namespace detail
+
+template<typename T>
+struct task
+  : concepts::no_copy
+{
+  using promise_type = detail::task_promise<T>;
+
+  constexpr task();
+  task(task&& task_);
+  ~task();
+
+  task& operator=(task&& task_);
+
+  bool is_valid() const;
+  bool is_ready() const;
+
+  // Run the task on the awaiting thread, the awaiting coroutine is resumed
+  // once it completed and receives it's result.
+  auto operator co_await() const noexcept;
+
+private:
+  friend struct detail::task_promise<T>;
+
+  explicit task(std::coroutine_handle<promise_type> _handle);
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+// Awaitable which suspends the awaiting coroutine and resumes it as a job on
+// |_pool| with |_priority|.
+struct schedule_awaiter {
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> _handle) const;
+  void await_resume() const noexcept {}
+
+  thread_pool& pool;
+  thread_pool::priority priority;
+};
+
+schedule_awaiter schedule(thread_pool& _pool,
+  thread_pool::priority _priority = thread_pool::priority::k_normal);
+
+// Awaitable which suspends the awaiting coroutine and resumes it as a job on
+// |_pool| with |_priority| once |_delay| has passed.
+struct schedule_after_awaiter {
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> _handle) const;
+  void await_resume() const noexcept {}
+
+  thread_pool& pool;
+  time::span delay;
+  thread_pool::priority priority;
+};
+
+schedule_after_awaiter schedule_after(thread_pool& _pool, const time::span& _delay,
+  thread_pool::priority _priority = thread_pool::priority::k_normal);
+
+// detail::task_promise
+template<typename T>
+inline detail::task_promise<T>::task_promise()
+  : m_has_value{false}
+{
+}
+
+template<typename T>
+inline detail::task_promise<T>::~task_promise() {
+  if (m_has_value) {
+    m_value.fini();
+  }
+}
+
+template<typename T>
+inline task<T> detail::task_promise<T>::get_return_object() {
+  return task<T>{std::coroutine_handle<task_promise>::from_promise(*this)};
+}
+
+template<typename T>
+template<typename U>
+inline void detail::task_promise<T>::return_value(U&& _value) {
+  m_value.init(utility::forward<U>(_value));
+  m_has_value = true;
+}
+
+template<typename T>
+inline T&& detail::task_promise<T>::result() {
+  RX_ASSERT(m_has_value, "task has no result");
+  return utility::move(*m_value.data());
+}
+
+inline task<void> detail::task_promise<void>::get_return_object() {
+  return task<void>{std::coroutine_handle<task_promise>::from_promise(*this)};
+}
+
+template<typename T>
+inline detail::task_detached detail::task_run(thread_pool& _pool,
+  thread_pool::priority _priority, task<T> _task, future_state<T>* _state)
+{
+  co_await schedule(_pool, _priority);
+  if constexpr (traits::is_void<T>) {
+    co_await _task;
+    _state->set_value();
+  } else {
+    _state->set_value(co_await _task);
+  }
+  _state->release();
+}
+
+// task
+template<typename T>
+inline constexpr task<T>::task()
+  : m_handle{nullptr}
+{
+}
+
+template<typename T>
+inline task<T>::task(std::coroutine_handle<promise_type> _handle)
+  : m_handle{_handle}
+{
+}
+
+template<typename T>
+inline task<T>::task(task&& task_)
+  : m_handle{utility::exchange(task_.m_handle, nullptr)}
+{
+}
+
+template<typename T>
+inline task<T>::~task() {
+  if (m_handle) {
+    m_handle.destroy();
+  }
+}
+
+template<typename T>
+inline task<T>& task<T>::operator=(task&& task_) {
+  RX_ASSERT(&task_ != this, "self assignment");
+  if (m_handle) {
+    m_handle.destroy();
+  }
+  m_handle = utility::exchange(task_.m_handle, nullptr);
+  return *this;
+}
+
+template<typename T>
+inline bool task<T>::is_valid() const {
+  return static_cast<bool>(m_handle);
+}
+
+template<typename T>
+inline bool task<T>::is_ready() const {
+  return m_handle && m_handle.done();
+}
+
+template<typename T>
+inline auto task<T>::operator co_await() const noexcept {
+  struct awaiter {
+    bool await_ready() const noexcept {
+      return handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> _continuation) const noexcept {
+      handle.promise().continuation = _continuation;
+      return handle;
+    }
+
+    decltype(auto) await_resume() const {
+      return handle.promise().result();
+    }
+
+    std::coroutine_handle<promise_type> handle;
+  };
+
+  RX_ASSERT(m_handle, "invalid task");
+  return awaiter{m_handle};
+}
+
+// schedule_awaiter
+inline void schedule_awaiter::await_suspend(std::coroutine_handle<> _handle) const {
+  pool.add([_handle](int) { _handle.resume(); }, priority);
+}
+
+inline schedule_awaiter schedule(thread_pool& _pool, thread_pool::priority _priority) {
+  return {_pool, _priority};
+}
+
+// schedule_after_awaiter
+inline void schedule_after_awaiter::await_suspend(std::coroutine_handle<> _handle) const {
+  pool.add_after(delay, [_handle](int) { _handle.resume(); }, priority);
+}
+
+inline schedule_after_awaiter schedule_after(thread_pool& _pool,
+  const time::span& _delay, thread_pool::priority _priority)
+{
+  return {_pool, _delay, _priority};
+}
+
+// thread_pool::spawn
+template<typename T>
+inline future<T> thread_pool::spawn(task<T>&& task_, priority _priority) {
+  auto state = allocator().create<detail::future_state<T>>(*this);
+  RX_ASSERT(state, "out of memory");
+  detail::task_run(*this, _priority, utility::move(task_), state);
+  return future<T>{state};
+}
+
+} // namespace rx::concurrency
+
+#endif // defined(__cpp_impl_coroutine)
+
+#endif // RX_CORE_CONCURRENCY_TASK_H
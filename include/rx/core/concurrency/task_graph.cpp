@@ -0,0 +1,183 @@
+#include "rx/core/concurrency/task_graph.h"
+#include "rx/core/concurrency/scope_lock.h"
+
+#include "rx/core/algorithm/topological_sort.h"
+
+#include "rx/core/log.h"
+
+namespace rx::concurrency {
+
+RX_LOG("task_graph", logger);
+
+task_graph::node::node(memory::allocator& _allocator, function<void(int)>&& task_)
+  : task{utility::move(task_)}
+  , dependents{_allocator}
+  , dependencies{0}
+{
+}
+
+task_graph::task_graph(memory::allocator& _allocator)
+  : m_allocator{_allocator}
+  , m_nodes{allocator()}
+  , m_counters{nullptr}
+  , m_counters_size{0}
+  , m_compiled{false}
+  , m_pool{nullptr}
+  , m_remaining{0}
+  , m_done{true}
+{
+}
+
+task_graph::~task_graph() {
+  wait();
+  allocator().deallocate(m_counters);
+}
+
+rx_size task_graph::add(function<void(int)>&& task_) {
+  m_compiled = false;
+  const rx_size index{m_nodes.size()};
+  return m_nodes.emplace_back(allocator(), utility::move(task_)) ? index : -1_z;
+}
+
+bool task_graph::add_dependency(rx_size _task, rx_size _dependency) {
+  if (_task >= m_nodes.size() || _dependency >= m_nodes.size()) {
+    return false;
+  }
+
+  // Cannot be a dependency of one-self.
+  if (_task == _dependency) {
+    return false;
+  }
+
+  auto& dependents{m_nodes[_dependency].dependents};
+
+  // Already a dependency.
+  if (dependents.find(_task) != vector<rx_size>::k_npos) {
+    return true;
+  }
+
+  if (!dependents.push_back(_task)) {
+    return false;
+  }
+
+  m_nodes[_task].dependencies++;
+  m_compiled = false;
+
+  return true;
+}
+
+bool task_graph::compile() {
+  RX_ASSERT(m_remaining.load() == 0, "graph still running");
+
+  // Validate the graph has no cycles, otherwise the tasks in them would never
+  // become ready.
+  algorithm::topological_sort<rx_size> sort{allocator()};
+  const rx_size nodes{m_nodes.size()};
+  for (rx_size i{0}; i < nodes; i++) {
+    sort.add(i);
+    m_nodes[i].dependents.each_fwd([&](rx_size _dependent) {
+      sort.add(_dependent, i);
+    });
+  }
+
+  const auto result{sort.sort()};
+  if (!result.cycled.is_empty()) {
+    logger->error("%zu tasks form a dependency cycle", result.cycled.size());
+    return false;
+  }
+
+  // Reuse the counters between compilations when there's enough of them.
+  if (m_counters_size < nodes) {
+    auto counters = allocator().reallocate(m_counters, sizeof *m_counters * nodes);
+    if (!counters) {
+      return false;
+    }
+    m_counters = reinterpret_cast<atomic<rx_size>*>(counters);
+    m_counters_size = nodes;
+  }
+
+  for (rx_size i{0}; i < nodes; i++) {
+    utility::construct<atomic<rx_size>>(m_counters + i, 0_z);
+  }
+
+  m_compiled = true;
+  return true;
+}
+
+void task_graph::submit(thread_pool& _pool) {
+  RX_ASSERT(m_compiled, "graph not compiled");
+
+  // Wait for any previous submission to finish before resetting the counters.
+  wait();
+
+  const rx_size nodes{m_nodes.size()};
+  if (nodes == 0) {
+    return;
+  }
+
+  m_pool = &_pool;
+  for (rx_size i{0}; i < nodes; i++) {
+    m_counters[i].store(m_nodes[i].dependencies, memory_order::k_relaxed);
+  }
+
+  {
+    scope_lock lock{m_mutex};
+    m_done = false;
+  }
+
+  m_remaining.store(nodes);
+
+  for (rx_size i{0}; i < nodes; i++) {
+    if (m_nodes[i].dependencies == 0) {
+      schedule(i);
+    }
+  }
+}
+
+void task_graph::wait() {
+  scope_lock lock{m_mutex};
+  m_done_cond.wait(lock, [this] { return m_done; });
+}
+
+void task_graph::schedule(rx_size _index) {
+  m_pool->add([this, _index](int _thread_id) {
+    execute(_index, _thread_id);
+  });
+}
+
+void task_graph::execute(rx_size _index, int _thread_id) {
+  for (;;) {
+    const auto& node{m_nodes[_index]};
+    node.task(_thread_id);
+
+    // Release the dependents of this task. Keep the first one which became
+    // ready to run as a continuation on this thread.
+    rx_size next{-1_z};
+    node.dependents.each_fwd([&](rx_size _dependent) {
+      if (m_counters[_dependent].fetch_sub(1) == 1) {
+        if (next == -1_z) {
+          next = _dependent;
+        } else {
+          schedule(_dependent);
+        }
+      }
+    });
+
+    // Every other task has completed, the graph may be destroyed as soon as
+    // |m_mutex| is released so nothing can be touched after this.
+    if (m_remaining.fetch_sub(1) == 1) {
+      scope_lock lock{m_mutex};
+      m_done = true;
+      m_done_cond.broadcast();
+      return;
+    }
+
+    if (next == -1_z) {
+      return;
+    }
+
+    _index = next;
+  }
+}
+
+} // namespace rx::concurrency
@@ -0,0 +1,101 @@
+#ifndef RX_CORE_CONCURRENCY_TASK_GRAPH_H
+#define RX_CORE_CONCURRENCY_TASK_GRAPH_H
+#include "rx/core/function.h"
+#include "rx/core/vector.h"
+
+#include "rx/core/concurrency/thread_pool.h"
+#include "rx/core/concurrency/atomic.h"
+#include "rx/core/concurrency/mutex.h"
+#include "rx/core/concurrency/condition_variable.h"
+
+#include "rx/core/hints/empty_bases.h"
+
+namespace rx::concurrency {
+
+// # Task Graph
+//
+// A set of tasks and dependency edges between them which is scheduled on a
+// thread pool as a whole.
+//
+// Once compiled, every task carries an atomic counter of unfinished
+// dependencies. Submitting the graph adds the tasks without dependencies to
+// the pool. When a task finishes it decrements the counters of its dependents
+// and every dependent that reaches zero becomes ready. The first ready
+// dependent runs as a continuation on the same worker, the others are added to
+// the pool. No worker ever blocks waiting on a dependency.
+//
+// A compiled graph can be submitted again after |wait| returns, e.g once every
+// frame, without allocating anything besides the root jobs.
+struct RX_HINT_EMPTY_BASES task_graph
+  : concepts::no_copy
+  , concepts::no_move
+{
+  task_graph(memory::allocator& _allocator);
+  task_graph();
+  ~task_graph();
+
+  // add |task_| to the graph and return it's handle, the integer passed to
+  // |task_| is the thread id of the thread in the pool running it
+  rx_size add(function<void(int)>&& task_);
+
+  // make |_task| run only after |_dependency| has completed
+  bool add_dependency(rx_size _task, rx_size _dependency);
+
+  // validate the graph and prepare it for submission, this must be called
+  // after the graph is modified and before it's submitted, returns false when
+  // the dependencies form a cycle
+  [[nodiscard]] bool compile();
+
+  // schedule every task of the graph on |_pool|
+  void submit(thread_pool& _pool);
+
+  // block the calling thread until every task of the last submission completed
+  void wait();
+
+  rx_size size() const;
+
+  constexpr memory::allocator& allocator() const;
+
+private:
+  struct node {
+    node(memory::allocator& _allocator, function<void(int)>&& task_);
+    function<void(int)> task;
+    vector<rx_size> dependents;
+    rx_size dependencies;
+  };
+
+  void schedule(rx_size _index);
+  void execute(rx_size _index, int _thread_id);
+
+  ref<memory::allocator> m_allocator;
+  vector<node> m_nodes;
+
+  // Dependency counters, one per node, reset on every submission.
+  atomic<rx_size>* m_counters;
+  rx_size m_counters_size;
+  bool m_compiled;
+
+  thread_pool* m_pool;
+  atomic<rx_size> m_remaining;
+
+  mutex m_mutex;
+  condition_variable m_done_cond;
+  bool m_done; // protected by |m_mutex|
+};
+
+inline task_graph::task_graph()
+  : task_graph{memory::system_allocator::instance()}
+{
+}
+
+RX_HINT_FORCE_INLINE rx_size task_graph::size() const {
+  return m_nodes.size();
+}
+
+RX_HINT_FORCE_INLINE constexpr memory::allocator& task_graph::allocator() const {
+  return m_allocator;
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_TASK_GRAPH_H
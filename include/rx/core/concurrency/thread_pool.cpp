@@ -1,8 +1,17 @@
 #include "rx/core/concurrency/thread_pool.h"
+#include "rx/core/concurrency/topology.h"
 #include "rx/core/concurrency/wait_group.h"
+#include "rx/core/concurrency/scope_lock.h"
+#include "rx/core/concurrency/yield.h"
 
 #include "rx/core/time/stopwatch.h"
 #include "rx/core/time/delay.h"
+#include "rx/core/time/span.h"
+#include "rx/core/time/qpc.h"
+
+#include "rx/core/utility/bit.h"
+
+#include "rx/core/hints/likely.h"
 
 #include "rx/core/log.h"
 
@@ -10,67 +19,202 @@ namespace rx::concurrency {
 
 RX_LOG("thread_pool", logger);
 
-global<thread_pool> thread_pool::s_instance{"system", "thread_pool", 4_z, 4096_z};
+global<thread_pool> thread_pool::s_instance{"system", "thread_pool", 0_z, 4096_z};
 
-struct RX_HINT_EMPTY_BASES work
+struct RX_HINT_EMPTY_BASES thread_pool::work
   : concepts::no_copy
   , concepts::no_move
 {
-  work(function<void(int)>&& callback_)
+  work(function<void(int)>&& callback_, rx_size _lane)
     : callback{utility::move(callback_)}
+    , lane{_lane}
+    , queued_ticks{time::qpc_ticks()}
   {
   }
 
   intrusive_list::node link;
   function<void(int)> callback;
+  rx_size lane;
+  rx_u64 queued_ticks;
+};
+
+struct thread_pool::timer_node
+  : timer_wheel::timer
+{
+  function<void(int)> callback;
+  rx_u64 period; // ticks between expiries, zero for a one-shot timer
+  rx_u64 serial; // identifies the current use of the node, zero when free
+  priority lane;
 };
 
+static constexpr const rx_size k_high{static_cast<rx_size>(thread_pool::priority::k_high)};
+static constexpr const rx_size k_normal{static_cast<rx_size>(thread_pool::priority::k_normal)};
+static constexpr const rx_size k_background{static_cast<rx_size>(thread_pool::priority::k_background)};
+
+// The pool, queue index and thread id of the calling thread when it's a worker
+// thread, used to push jobs added from within a job onto the worker's own queue.
+//
+// |until_background| counts down the jobs of other priorities the worker may
+// run before it must try to take a background job first.
+static thread_local struct {
+  thread_pool* pool;
+  rx_size index;
+  int thread_id;
+  rx_size until_background;
+} t_worker{nullptr, 0, -1, 0};
+
+// The current time in timer ticks, which are milliseconds.
+static rx_u64 timer_tick() {
+  const rx_u64 frequency{time::qpc_frequency() / 1000};
+  return time::qpc_ticks() / (frequency ? frequency : 1);
+}
+
+// The number of whole ticks in |_span|, rounded up.
+static rx_u64 timer_ticks(const time::span& _span) {
+  const rx_f64 milliseconds{_span.total_milliseconds()};
+  if (milliseconds <= 0.0) {
+    return 0;
+  }
+  const auto ticks{static_cast<rx_u64>(milliseconds)};
+  return static_cast<rx_f64>(ticks) < milliseconds ? ticks + 1 : ticks;
+}
+
+// Convert |_ticks| of the performance counter to nanoseconds.
+static rx_u64 nanoseconds(rx_u64 _ticks) {
+  static const rx_u64 k_frequency{time::qpc_frequency()};
+  static constexpr const rx_u64 k_second{1000000000};
+  return _ticks / k_frequency * k_second + _ticks % k_frequency * k_second / k_frequency;
+}
+
+// Round |_value| up to the next power of two.
+static rx_size next_power_of_two(rx_size _value) {
+  rx_size result{2};
+  while (result < _value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+// Leave a logical core for the thread that created the pool, which usually
+// participates in the work too, e.g with |parallel_for| or |future::wait|.
+static rx_size default_thread_count(memory::allocator& _allocator) {
+  const topology machine{_allocator};
+  return machine.logical_cores() > 1 ? machine.logical_cores() - 1 : 1;
+}
+
 thread_pool::thread_pool(memory::allocator& _allocator, rx_size _threads, rx_size _static_pool_size)
+  : thread_pool{_allocator, _threads ? _threads : default_thread_count(_allocator),
+      _static_pool_size, nullptr}
+{
+}
+
+thread_pool::thread_pool(memory::allocator& _allocator, const vector<rx_size>& _cpus,
+  rx_size _static_pool_size)
+  : thread_pool{_allocator, _cpus.size(), _static_pool_size, &_cpus}
+{
+}
+
+thread_pool::thread_pool(memory::allocator& _allocator, rx_size _threads,
+  rx_size _static_pool_size, const vector<rx_size>* _cpus)
   : m_allocator{_allocator}
+  , m_queue_memory{nullptr}
+  , m_queues{nullptr}
+  , m_queue_count{_threads}
+  , m_pending{0_z, 0_z, 0_z}
+  , m_peak_pending{0}
+  , m_external_stats{}
+  , m_created_ticks{time::qpc_ticks()}
+  , m_background_active{0}
+  , m_background_limit{_threads}
+  , m_next{0}
+  , m_sleeping{0}
   , m_threads{allocator()}
-  , m_job_memory{allocator(), sizeof(work), _static_pool_size}
   , m_stop{false}
+  , m_job_memory{nullptr}
+  , m_job_count{_static_pool_size}
+  , m_free_jobs{allocator(), next_power_of_two(_static_pool_size)}
+  , m_timer_wheel{timer_tick()}
+  , m_timer_nodes{allocator()}
+  , m_timer_serial{0}
+  , m_timer_wake_tick{-1_u64}
+  , m_timer_stop{false}
+  , m_timer_thread{allocator()}
+  , m_timer_signal{0}
 {
   time::stopwatch timer;
   timer.start();
 
+  RX_ASSERT(_threads, "no threads");
+
+  // Over allocate by a cache line to align the queues on a cache line.
+  m_queue_memory = allocator().allocate(sizeof(padded_queue) * m_queue_count + k_cache_line);
+  RX_ASSERT(m_queue_memory, "out of memory");
+
+  const auto address = reinterpret_cast<rx_uintptr>(m_queue_memory);
+  m_queues = reinterpret_cast<padded_queue*>((address + k_cache_line - 1) & ~(k_cache_line - 1));
+  for (rx_size i{0}; i < m_queue_count; i++) {
+    utility::construct<padded_queue>(m_queues + i);
+  }
+
+  // Preallocate the job slots and make them all available.
+  m_job_memory = allocator().allocate(sizeof(work) * m_job_count);
+  RX_ASSERT(m_job_memory, "out of memory");
+  for (rx_size i{0}; i < m_job_count; i++) {
+    m_free_jobs.push(reinterpret_cast<work*>(m_job_memory + sizeof(work) * i));
+  }
+
   logger->info("starting pool with %zu threads", _threads);
   m_threads.reserve(_threads);
 
   wait_group group{_threads};
   for (rx_size i{0}; i < _threads; i++) {
-    m_threads.emplace_back("thread pool", [this, &group](int _thread_id) {
+    const rx_size cpu{_cpus ? (*_cpus)[i] : -1_z};
+    m_threads.emplace_back("thread pool", [this, i, cpu, &group](int _thread_id) {
       logger->info("starting thread %d", _thread_id);
 
+      if (cpu != -1_z && !topology::set_affinity(cpu)) {
+        logger->warning("failed to pin thread %d to cpu %zu", _thread_id, cpu);
+      }
+
+      t_worker.pool = this;
+      t_worker.index = i;
+      t_worker.thread_id = _thread_id;
+      t_worker.until_background = k_background_interval;
+
       group.signal();
 
       for (;;) {
-        function<void(int)> task;
-        {
+        work* item = take(i);
+
+        if (!item) {
+          // The pending count is incremented before the job is pushed, it's
+          // possible to observe a pending job which isn't in a queue yet.
+          if (has_runnable_work()) {
+            yield();
+            continue;
+          }
+
           scope_lock lock{m_mutex};
-          m_task_cond.wait(lock, [this] { return m_stop || !m_queue.is_empty(); });
-          if (m_stop && m_queue.is_empty()) {
+
+          // Publish that this worker is about to park before checking for
+          // pending work again. This pairs with |add| which increments
+          // |m_pending| before checking |m_sleeping|, so either this thread
+          // observes the new job or |add| observes this thread sleeping.
+          m_sleeping.fetch_add(1);
+          m_task_cond.wait(lock, [this] { return m_stop || has_runnable_work(); });
+          m_sleeping.fetch_sub(1);
+
+          // Background jobs held back by the limit are still run before
+          // stopping, the workers running background jobs will get to them.
+          if (m_stop && !has_runnable_work()) {
             logger->info("stopping thread %d", _thread_id);
             return;
           }
 
-          auto node = m_queue.pop_back();
-          auto item = node->data<work>(&work::link);
-
-          task = utility::move(item->callback);
-
-          m_job_memory.destroy(item);
+          continue;
         }
 
-        logger->verbose("starting task on thread %d", _thread_id);
-
-        time::stopwatch timer;
-        timer.start();
-        task(_thread_id);
-        timer.stop();
-
-        logger->verbose("finished task on thread %d (took %s)",
-          _thread_id, timer.elapsed());
+        execute(item, _thread_id, m_queues[i].as_queue.stats);
       }
     });
   }
@@ -86,6 +230,19 @@ thread_pool::thread_pool(memory::allocator& _allocator, rx_size _threads, rx_siz
 thread_pool::~thread_pool() {
   time::stopwatch timer;
   timer.start();
+
+  // Stop the timer thread first so it doesn't add jobs to stopped workers.
+  // Timers which didn't expire yet are dropped.
+  {
+    scope_lock lock{m_timer_mutex};
+    m_timer_stop = true;
+  }
+  m_timer_signal.fetch_add(1);
+  m_timer_signal.notify_one();
+  if (m_timer_thread) {
+    m_timer_thread->join();
+  }
+
   {
     scope_lock lock{m_mutex};
     m_stop = true;
@@ -96,18 +253,436 @@ thread_pool::~thread_pool() {
     _thread.join();
   });
 
+  for (rx_size i{0}; i < m_queue_count; i++) {
+    utility::destruct<padded_queue>(m_queues + i);
+  }
+  allocator().deallocate(m_queue_memory);
+  allocator().deallocate(m_job_memory);
+
+  m_timer_nodes.each_fwd([this](timer_node* _node) {
+    allocator().destroy<timer_node>(_node);
+  });
+
   timer.stop();
   logger->verbose("stopped pool with %zu threads (took %s)",
     m_threads.size(), timer.elapsed());
 }
 
-void thread_pool::add(function<void(int)>&& task_) {
-  {
+void thread_pool::add(function<void(int)>&& task_, priority _priority) {
+  const auto lane{static_cast<rx_size>(_priority)};
+  work* item = create_work(utility::move(task_), lane);
+
+  // Jobs added from a worker of this pool go on that worker's own queue,
+  // otherwise distribute them round-robin.
+  const rx_size index = t_worker.pool == this
+    ? t_worker.index
+    : m_next.fetch_add(1, memory_order::k_relaxed) % m_queue_count;
+
+  // The peak is only approximate, the lanes aren't counted at the same time.
+  const rx_size depth{m_pending[lane].fetch_add(1) + 1
+    + m_pending[(lane + 1) % k_priorities].load(memory_order::k_relaxed)
+    + m_pending[(lane + 2) % k_priorities].load(memory_order::k_relaxed)};
+  for (rx_size peak{m_peak_pending.load(memory_order::k_relaxed)}; depth > peak; ) {
+    if (m_peak_pending.compare_exchange_weak(peak, depth, memory_order::k_relaxed)) {
+      break;
+    }
+  }
+
+  push(index, item);
+
+  if (m_sleeping.load() != 0) {
     scope_lock lock{m_mutex};
-    auto item = m_job_memory.create<work>(utility::move(task_));
-    m_queue.push_back(&item->link);
+    m_task_cond.signal();
+  }
+}
+
+thread_pool::timer thread_pool::add_after(const time::span& _delay,
+  function<void(int)>&& task_, priority _priority)
+{
+  return add_timer(timer_ticks(_delay), 0, utility::move(task_), _priority);
+}
+
+thread_pool::timer thread_pool::add_every(const time::span& _period,
+  function<void(int)>&& task_, priority _priority)
+{
+  const rx_u64 period{timer_ticks(_period)};
+  return add_timer(period, period ? period : 1, utility::move(task_), _priority);
+}
+
+bool thread_pool::cancel(const timer& _timer) {
+  if (!_timer.m_node) {
+    return false;
+  }
+
+  scope_lock lock{m_timer_mutex};
+  // Nodes are never freed while the pool exists, the serial tells whether the
+  // node still belongs to this timer.
+  auto node{static_cast<timer_node*>(_timer.m_node)};
+  if (node->serial != _timer.m_serial) {
+    return false;
+  }
+
+  m_timer_wheel.erase(node);
+  release_timer(node);
+  return true;
+}
+
+void thread_pool::set_background_limit(rx_size _limit) {
+  RX_ASSERT(_limit, "background jobs could never run");
+  m_background_limit.store(_limit);
+
+  // Workers may be parked on background jobs the previous limit held back.
+  if (m_sleeping.load() != 0) {
+    scope_lock lock{m_mutex};
+    m_task_cond.broadcast();
+  }
+}
+
+bool thread_pool::run_one() {
+  // Workers start with their own queue, other threads steal from a different
+  // queue every time.
+  const bool worker{t_worker.pool == this};
+  const rx_size index = worker
+    ? t_worker.index
+    : m_next.fetch_add(1, memory_order::k_relaxed) % m_queue_count;
+
+  if (work* item = take(index)) {
+    if (worker) {
+      execute(item, t_worker.thread_id, m_queues[index].as_queue.stats);
+    } else {
+      execute(item, -1, m_external_stats);
+    }
+    return true;
+  }
+
+  return false;
+}
+
+void thread_pool::execute(work* _work, int _thread_id, counters& counters_) {
+  function<void(int)> task{utility::move(_work->callback)};
+  const rx_size lane{_work->lane};
+  const rx_u64 queued_ticks{_work->queued_ticks};
+  destroy_work(_work);
+
+  const rx_u64 start_ticks{time::qpc_ticks()};
+  task(_thread_id);
+  const rx_u64 stop_ticks{time::qpc_ticks()};
+
+  const rx_u64 run_time{nanoseconds(stop_ticks - start_ticks)};
+  counters_.queue_delay.record(nanoseconds(start_ticks - queued_ticks));
+  counters_.run_time.record(run_time);
+  counters_.jobs.fetch_add(1, memory_order::k_relaxed);
+  counters_.busy.fetch_add(run_time, memory_order::k_relaxed);
+
+  if (lane == k_background) {
+    m_background_active.fetch_sub(1);
+    // Another background job may have been held back by the limit while this
+    // one ran, wake a worker for it.
+    if (m_pending[k_background].load() != 0 && m_sleeping.load() != 0) {
+      scope_lock lock{m_mutex};
+      m_task_cond.signal();
+    }
+  }
+}
+
+thread_pool::statistics thread_pool::stats() const {
+  statistics result{};
+  result.workers = vector<statistics::worker>{allocator(), m_queue_count};
+
+  for (rx_size i{0}; i < m_queue_count; i++) {
+    const auto& stats{m_queues[i].as_queue.stats};
+    stats.queue_delay.sum(result.queue_delay);
+    stats.run_time.sum(result.run_time);
+    result.workers[i].jobs = stats.jobs.load(memory_order::k_relaxed);
+    result.workers[i].busy = stats.busy.load(memory_order::k_relaxed);
+  }
+
+  m_external_stats.queue_delay.sum(result.queue_delay);
+  m_external_stats.run_time.sum(result.run_time);
+
+  result.elapsed = nanoseconds(time::qpc_ticks() - m_created_ticks);
+
+  for (rx_size i{0}; i < k_priorities; i++) {
+    result.queue_depth += m_pending[i].load(memory_order::k_relaxed);
+  }
+  result.peak_queue_depth = m_peak_pending.load(memory_order::k_relaxed);
+
+  return result;
+}
+
+void thread_pool::histogram_counters::record(rx_u64 _duration) {
+  // Bucket by the position of the highest set bit.
+  const rx_size bucket{_duration ? bit_search_msb(_duration) : 0};
+  buckets[bucket < statistics::histogram::k_buckets ? bucket : statistics::histogram::k_buckets - 1]
+    .fetch_add(1, memory_order::k_relaxed);
+  total.fetch_add(_duration, memory_order::k_relaxed);
+  for (rx_u64 value{max.load(memory_order::k_relaxed)}; _duration > value; ) {
+    if (max.compare_exchange_weak(value, _duration, memory_order::k_relaxed)) {
+      break;
+    }
+  }
+}
+
+void thread_pool::histogram_counters::sum(statistics::histogram& histogram_) const {
+  for (rx_size i{0}; i < statistics::histogram::k_buckets; i++) {
+    histogram_.buckets[i] += buckets[i].load(memory_order::k_relaxed);
+  }
+  histogram_.total += total.load(memory_order::k_relaxed);
+  const rx_u64 value{max.load(memory_order::k_relaxed)};
+  if (value > histogram_.max) {
+    histogram_.max = value;
+  }
+}
+
+rx_u64 thread_pool::statistics::histogram::count() const {
+  rx_u64 result{0};
+  for (rx_size i{0}; i < k_buckets; i++) {
+    result += buckets[i];
+  }
+  return result;
+}
+
+rx_u64 thread_pool::statistics::histogram::mean() const {
+  const rx_u64 samples{count()};
+  return samples ? total / samples : 0;
+}
+
+rx_u64 thread_pool::statistics::histogram::percentile(rx_f64 _fraction) const {
+  const rx_u64 samples{count()};
+  const auto target{static_cast<rx_u64>(_fraction * static_cast<rx_f64>(samples))};
+  rx_u64 seen{0};
+  for (rx_size i{0}; i < k_buckets - 1; i++) {
+    seen += buckets[i];
+    if (seen > target || (seen == samples && samples)) {
+      // The end of the bucket, but never more than the longest duration seen.
+      const rx_u64 bound{(1_u64 << (i + 1)) - 1};
+      return bound < max ? bound : max;
+    }
+  }
+  return max;
+}
+
+rx_f64 thread_pool::statistics::worker::utilization(rx_u64 _elapsed) const {
+  return _elapsed ? static_cast<rx_f64>(busy) / static_cast<rx_f64>(_elapsed) : 0.0;
+}
+
+void thread_pool::push(rx_size _index, work* _work) {
+  auto& queue = m_queues[_index].as_queue;
+  scope_lock lock{queue.lock};
+  queue.lanes[_work->lane].push_back(&_work->link);
+}
+
+thread_pool::work* thread_pool::pop(rx_size _index, rx_size _lane) {
+  auto& queue = m_queues[_index].as_queue;
+  scope_lock lock{queue.lock};
+  if (auto node = queue.lanes[_lane].pop_back()) {
+    return node->data<work>(&work::link);
+  }
+  return nullptr;
+}
+
+thread_pool::work* thread_pool::steal(rx_size _index, rx_size _lane) {
+  auto& queue = m_queues[_index].as_queue;
+  scope_lock lock{queue.lock};
+  if (auto node = queue.lanes[_lane].pop_front()) {
+    return node->data<work>(&work::link);
+  }
+  return nullptr;
+}
+
+thread_pool::work* thread_pool::take(rx_size _index, rx_size _lane) {
+  // Avoid touching the queue locks of a lane known to be empty.
+  if (m_pending[_lane].load(memory_order::k_relaxed) == 0) {
+    return nullptr;
+  }
+
+  // Try our own queue first, then steal from the other workers starting with
+  // our neighbour so thieves spread out over the victims.
+  work* item = pop(_index, _lane);
+  for (rx_size i{1}; !item && i < m_queue_count; i++) {
+    item = steal((_index + i) % m_queue_count, _lane);
+  }
+
+  if (item) {
+    m_pending[_lane].fetch_sub(1);
+  }
+
+  return item;
+}
+
+thread_pool::work* thread_pool::take_background(rx_size _index) {
+  if (m_pending[k_background].load(memory_order::k_relaxed) == 0) {
+    return nullptr;
+  }
+
+  // Reserve a background slot before taking the job, released by |execute|
+  // once the job completed.
+  rx_size active{m_background_active.load()};
+  do {
+    if (active >= m_background_limit.load()) {
+      return nullptr;
+    }
+  } while (!m_background_active.compare_exchange_weak(active, active + 1,
+    memory_order::k_seq_cst));
+
+  if (work* item = take(_index, k_background)) {
+    return item;
+  }
+
+  m_background_active.fetch_sub(1);
+  return nullptr;
+}
+
+thread_pool::work* thread_pool::take(rx_size _index) {
+  // Workers which ran |k_background_interval| jobs since their last background
+  // job try a background job first so they cannot starve.
+  const bool worker{t_worker.pool == this};
+  if (worker && t_worker.until_background == 0) {
+    if (work* item = take_background(_index)) {
+      t_worker.until_background = k_background_interval;
+      return item;
+    }
+  }
+
+  for (rx_size lane{k_high}; lane < k_background; lane++) {
+    if (work* item = take(_index, lane)) {
+      if (worker && t_worker.until_background) {
+        t_worker.until_background--;
+      }
+      return item;
+    }
+  }
+
+  if (work* item = take_background(_index)) {
+    if (worker) {
+      t_worker.until_background = k_background_interval;
+    }
+    return item;
+  }
+
+  return nullptr;
+}
+
+bool thread_pool::has_runnable_work() const {
+  if (m_pending[k_high].load() != 0 || m_pending[k_normal].load() != 0) {
+    return true;
+  }
+  return m_pending[k_background].load() != 0
+    && m_background_active.load() < m_background_limit.load();
+}
+
+thread_pool::work* thread_pool::create_work(function<void(int)>&& callback_, rx_size _lane) {
+  work* item;
+  if (RX_HINT_LIKELY(m_free_jobs.pop(item))) {
+    return utility::construct<work>(item, utility::move(callback_), _lane);
+  }
+
+  // All slots are in use, fall back to the allocator.
+  item = allocator().create<work>(utility::move(callback_), _lane);
+  RX_ASSERT(item, "out of memory");
+  return item;
+}
+
+void thread_pool::destroy_work(work* _work) {
+  const auto data = reinterpret_cast<rx_byte*>(_work);
+  if (data >= m_job_memory && data < m_job_memory + sizeof(work) * m_job_count) {
+    utility::destruct<work>(_work);
+    // The queue has room for every slot, this cannot fail.
+    m_free_jobs.push(_work);
+  } else {
+    allocator().destroy<work>(_work);
+  }
+}
+
+thread_pool::timer thread_pool::add_timer(rx_u64 _delay, rx_u64 _period,
+  function<void(int)>&& task_, priority _priority)
+{
+  scope_lock lock{m_timer_mutex};
+
+  timer_node* node{nullptr};
+  if (auto link = m_free_timers.pop_front()) {
+    node = static_cast<timer_node*>(link->data<timer_wheel::timer>(&timer_wheel::timer::link));
+  } else {
+    node = allocator().create<timer_node>();
+    RX_ASSERT(node, "out of memory");
+    m_timer_nodes.push_back(node);
+  }
+
+  node->callback = utility::move(task_);
+  node->period = _period;
+  node->serial = ++m_timer_serial;
+  node->lane = _priority;
+
+  // The wheel only moves forward when the timer thread advances it, measure
+  // the delay from the current time rather than from the wheel. Part of the
+  // current tick passed already, count from the next one so the timer never
+  // expires early.
+  const rx_u64 now{timer_tick()};
+  node->deadline = (now > m_timer_wheel.now() ? now : m_timer_wheel.now()) + _delay + 1;
+  m_timer_wheel.insert(node);
+
+  if (!m_timer_thread) {
+    m_timer_thread = make_ptr<thread>(allocator(), allocator(), "timer",
+      [this](int) { run_timers(); });
+  } else if (node->deadline < m_timer_wake_tick) {
+    // The timer thread sleeps past this timer, wake it up. It reads the signal
+    // before taking the lock so it cannot miss this.
+    m_timer_signal.fetch_add(1);
+    m_timer_signal.notify_one();
+  }
+
+  return {node, node->serial};
+}
+
+void thread_pool::release_timer(timer_node* _node) {
+  _node->callback = nullptr;
+  _node->serial = 0;
+  m_free_timers.push_back(&_node->link);
+}
+
+void thread_pool::run_timers() {
+  intrusive_list expired;
+  for (;;) {
+    const rx_u32 signal{m_timer_signal.load()};
+
+    rx_u64 wake{-1_u64};
+    rx_u64 now{0};
+    {
+      scope_lock lock{m_timer_mutex};
+      if (m_timer_stop) {
+        return;
+      }
+
+      now = timer_tick();
+      m_timer_wheel.advance(now, expired);
+
+      // Every expired timer is picked up in one pass, the jobs are added to
+      // the pool and the timer thread goes back to sleep.
+      while (auto link = expired.pop_front()) {
+        auto node{static_cast<timer_node*>(link->data<timer_wheel::timer>(&timer_wheel::timer::link))};
+        if (node->period) {
+          add(function<void(int)>{node->callback}, node->lane);
+          node->deadline += node->period;
+          if (node->deadline <= now) {
+            node->deadline = now + node->period;
+          }
+          m_timer_wheel.insert(node);
+        } else {
+          add(utility::move(node->callback), node->lane);
+          release_timer(node);
+        }
+      }
+
+      wake = m_timer_wheel.next_tick();
+      m_timer_wake_tick = wake;
+    }
+
+    if (wake == -1_u64) {
+      m_timer_signal.wait(signal);
+    } else if (wake > now) {
+      m_timer_signal.wait_for(signal, (wake - now) * 1000000);
+    }
   }
-  m_task_cond.signal();
 }
 
 } // namespace rx::concurrency
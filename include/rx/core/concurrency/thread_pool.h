@@ -2,52 +2,336 @@
 #define RX_CORE_CONCURRENCY_THREAD_POOL_H
 #include "rx/core/intrusive_list.h"
 #include "rx/core/function.h"
-#include "rx/core/dynamic_pool.h"
+#include "rx/core/vector.h"
 
 #include "rx/core/concurrency/thread.h"
 #include "rx/core/concurrency/mutex.h"
 #include "rx/core/concurrency/condition_variable.h"
+#include "rx/core/concurrency/spin_lock.h"
+#include "rx/core/concurrency/atomic.h"
+#include "rx/core/concurrency/cache_line.h"
+#include "rx/core/concurrency/bounded_queue.h"
+#include "rx/core/concurrency/timer_wheel.h"
 
 #include "rx/core/hints/empty_bases.h"
 
+namespace rx::time {
+  struct span;
+} // namespace rx::time
+
 namespace rx::concurrency {
 
+template<typename T>
+struct future;
+
+template<typename T>
+struct task;
+
+// # Thread Pool
+//
+// Work-stealing thread pool.
+//
+// Every worker thread owns a queue of jobs. Jobs added from a worker thread go
+// to the back of that worker's queue and the worker takes jobs from the back
+// too (LIFO), which keeps recently produced data hot in cache. Jobs added from
+// any other thread are distributed round-robin across the worker queues.
+//
+// A worker with an empty queue steals from the front (FIFO) of the queues of
+// the other workers, taking the oldest work first. Workers only park once every
+// queue is empty.
+//
+// Job nodes come from |_static_pool_size| preallocated slots which are recycled
+// through a lock-free queue, so neither adding nor completing a job takes a
+// global lock. Only when every slot is in use does a job fall back to being
+// allocated from the pool's allocator.
+//
+// Every job has a priority. Each worker queue keeps a separate lane per
+// priority and workers always drain the higher lanes, across every queue,
+// before looking at a lower one. To keep background jobs from starving every
+// worker takes a background job first, when there is one, after running
+// |k_background_interval| jobs of the other priorities. The number of workers
+// running background jobs at once can be capped with |set_background_limit|.
+//
+// Jobs can be delayed with |add_after| or repeated with |add_every|. Timers
+// are kept in a hierarchical |timer_wheel| with a resolution of a millisecond
+// and driven by a dedicated timer thread, started with the first timer, which
+// sleeps until the next timer expires and then adds the job to the pool. A
+// timer never occupies a worker before it fires.
+//
+// The pool keeps lock-free statistics of the time jobs wait in the queues and
+// the time they run for, the utilization of every worker and the depth of the
+// queues. Every worker counts into its own counters, |stats| sums them up into
+// a snapshot.
 struct RX_HINT_EMPTY_BASES thread_pool
   : concepts::no_copy
   , concepts::no_move
 {
+  enum class priority : rx_u8 {
+    k_high,       // latency critical, e.g work needed for the current frame
+    k_normal,
+    k_background  // throughput work, e.g compression or flushing logs
+  };
+
+  static constexpr const rx_size k_priorities{3};
+  static constexpr const rx_size k_background_interval{32};
+
+  // Snapshot of the statistics of the pool, all durations are in nanoseconds
+  // and counted since the pool was created. Take the difference of two
+  // snapshots for the statistics of the time between them.
+  struct statistics {
+    // Histogram of durations, bucket |i| counts the durations in the range
+    // [2^i, 2^(i+1)) with the first and last bucket open ended.
+    struct histogram {
+      static constexpr const rx_size k_buckets{40};
+
+      rx_u64 count() const;
+      rx_u64 mean() const;
+
+      // an upper bound of the duration which |_fraction| of the durations
+      // stay below, e.g 0.99 for the 99th percentile
+      rx_u64 percentile(rx_f64 _fraction) const;
+
+      rx_u64 buckets[k_buckets];
+      rx_u64 total;
+      rx_u64 max;
+    };
+
+    struct worker {
+      // fraction of |elapsed| the worker spent running jobs
+      rx_f64 utilization(rx_u64 _elapsed) const;
+
+      rx_u64 jobs;
+      rx_u64 busy;
+    };
+
+    histogram queue_delay; // from adding a job until it starts
+    histogram run_time;    // from the start to the end of a job
+
+    // Workers of the pool, jobs run by other threads with |run_one| are only
+    // counted in the histograms.
+    vector<worker> workers;
+    rx_u64 elapsed;
+
+    rx_size queue_depth;      // jobs waiting when the snapshot was taken
+    rx_size peak_queue_depth; // most jobs ever waiting at once
+  };
+
+  // Handle to a timer added with |add_after| or |add_every|, used to cancel
+  // it. Handles stay safe to use after the timer expired or was cancelled.
+  struct timer {
+    constexpr timer();
+  private:
+    friend struct thread_pool;
+    constexpr timer(void* _node, rx_u64 _serial);
+    void* m_node;
+    rx_u64 m_serial;
+  };
+
+  // create a pool with |_threads| workers, or one worker for every logical
+  // core but one when |_threads| is zero
   thread_pool(memory::allocator& _allocator, rx_size _threads, rx_size _static_pool_size);
-  thread_pool(rx_size _threads, rx_size _job_pool_size);
+  thread_pool(rx_size _threads, rx_size _static_pool_size);
+
+  // create a pool with a worker pinned to each of the logical cores |_cpus|
+  thread_pool(memory::allocator& _allocator, const vector<rx_size>& _cpus,
+    rx_size _static_pool_size);
+  thread_pool(const vector<rx_size>& _cpus, rx_size _static_pool_size);
+
   ~thread_pool();
 
-  // insert |_task| into the thread pool to be executed, the integer passed
-  // to |_task| is the thread id of the calling thread in the pool
-  void add(function<void(int)>&& task_);
+  // insert |_task| into the thread pool to be executed with |_priority|, the
+  // integer passed to |_task| is the thread id of the calling thread in the pool
+  void add(function<void(int)>&& task_, priority _priority = priority::k_normal);
+
+  // add |task_| with |_priority| once |_delay| has passed, rounded up to the
+  // next millisecond
+  timer add_after(const time::span& _delay, function<void(int)>&& task_,
+    priority _priority = priority::k_normal);
+
+  // add |task_| with |_priority| every |_period|, starting one |_period| from
+  // now, until cancelled. Periods missed because the timer thread fell behind
+  // are skipped rather than added in a burst
+  timer add_every(const time::span& _period, function<void(int)>&& task_,
+    priority _priority = priority::k_normal);
+
+  // cancel |_timer|, returns false when it already expired or was cancelled.
+  // A job already added by the timer still runs
+  bool cancel(const timer& _timer);
+
+  // insert |_function| into the thread pool and return a future for it's
+  // result, the integer passed to |_function| is the same as for |add|
+  //
+  // defined in "rx/core/concurrency/future.h" which must be included to use it
+  template<typename F>
+  auto submit(F&& _function, priority _priority = priority::k_normal);
+
+  // run the coroutine |task_| on the thread pool and return a future for it's
+  // result, the task starts as a job with |_priority|
+  //
+  // defined in "rx/core/concurrency/task.h" which must be included to use it,
+  // requires C++20 coroutines
+  template<typename T>
+  future<T> spawn(task<T>&& task_, priority _priority = priority::k_normal);
+
+  // limit the number of workers running background jobs at the same time to
+  // |_limit|, which must be at least one, defaults to every worker
+  void set_background_limit(rx_size _limit);
+
+  // take a single job and run it on the calling thread, returns false when no
+  // job was available. Threads outside the pool run the job with a thread id
+  // of -1. Used to make progress while waiting on the result of another job
+  bool run_one();
+
+  // the number of worker threads in the pool
+  rx_size thread_count() const;
+
+  // snapshot of the statistics of the pool
+  statistics stats() const;
 
   constexpr memory::allocator& allocator() const;
 
   static constexpr thread_pool& instance();
 
 private:
+  thread_pool(memory::allocator& _allocator, rx_size _threads,
+    rx_size _static_pool_size, const vector<rx_size>* _cpus);
+
+  struct work;
+  struct timer_node;
+
+  // Counters behind |statistics|, updated with relaxed atomics.
+  struct histogram_counters {
+    void record(rx_u64 _duration);
+    void sum(statistics::histogram& histogram_) const;
+
+    atomic<rx_u64> buckets[statistics::histogram::k_buckets];
+    atomic<rx_u64> total;
+    atomic<rx_u64> max;
+  };
+
+  struct counters {
+    histogram_counters queue_delay;
+    histogram_counters run_time;
+    atomic<rx_u64> jobs;
+    atomic<rx_u64> busy;
+  };
+
+  // Per-worker queue with a lane per priority. The owning worker pushes and
+  // pops from the back of a lane while other workers steal from the front.
+  // The counters are only updated by the owning worker.
+  struct queue {
+    spin_lock lock;
+    intrusive_list lanes[k_priorities]; // protected by |lock|
+    counters stats;
+  };
+
+  // Keep each queue on it's own cache lines to avoid false sharing between
+  // workers operating on their own queues.
+  union padded_queue {
+    padded_queue() : as_queue{} {}
+    ~padded_queue() { as_queue.~queue(); }
+    queue as_queue;
+    rx_byte as_padding[(sizeof(queue) + k_cache_line - 1) & ~(k_cache_line - 1)];
+  };
+
+  void push(rx_size _index, work* _work);
+  work* pop(rx_size _index, rx_size _lane);
+  work* steal(rx_size _index, rx_size _lane);
+  work* take(rx_size _index, rx_size _lane);
+  work* take_background(rx_size _index);
+  work* take(rx_size _index);
+  void execute(work* _work, int _thread_id, counters& counters_);
+
+  // Returns true when there are jobs that a worker is allowed to take.
+  bool has_runnable_work() const;
+
+  work* create_work(function<void(int)>&& callback_, rx_size _lane);
+  void destroy_work(work* _work);
+
+  timer add_timer(rx_u64 _delay, rx_u64 _period, function<void(int)>&& task_,
+    priority _priority);
+  void release_timer(timer_node* _node);
+  void run_timers();
+
   memory::allocator& m_allocator;
 
+  rx_byte* m_queue_memory;
+  padded_queue* m_queues;
+  rx_size m_queue_count;
+
+  // Number of jobs of every priority in all queues. Incremented before a job
+  // is pushed and decremented after a job is taken.
+  atomic<rx_size> m_pending[k_priorities];
+  atomic<rx_size> m_peak_pending;
+
+  // Counters of jobs run by threads outside the pool and the tick the pool
+  // was created on.
+  counters m_external_stats;
+  rx_u64 m_created_ticks;
+
+  // Number of workers running background jobs and the limit of it.
+  atomic<rx_size> m_background_active;
+  atomic<rx_size> m_background_limit;
+
+  // Round-robin index for jobs added by threads outside the pool.
+  atomic<rx_size> m_next;
+
+  // Number of workers parked on |m_task_cond|.
+  atomic<rx_size> m_sleeping;
+
   mutex m_mutex;
   condition_variable m_task_cond;
-  condition_variable m_ready_cond;
 
-  intrusive_list m_queue;    // protected by |m_mutex|
   vector<thread> m_threads;  // protected by |m_mutex|
-  dynamic_pool m_job_memory; // protected by |m_mutex|
   bool m_stop;               // protected by |m_mutex|
 
+  // Preallocated job slots, the free ones are kept in |m_free_jobs|.
+  rx_byte* m_job_memory;
+  rx_size m_job_count;
+  bounded_queue<work*> m_free_jobs;
+
+  // Timers and the thread driving them, ticks are milliseconds.
+  mutex m_timer_mutex;
+  timer_wheel m_timer_wheel;           // protected by |m_timer_mutex|
+  intrusive_list m_free_timers;        // protected by |m_timer_mutex|
+  vector<timer_node*> m_timer_nodes;   // protected by |m_timer_mutex|
+  rx_u64 m_timer_serial;               // protected by |m_timer_mutex|
+  rx_u64 m_timer_wake_tick;            // protected by |m_timer_mutex|
+  bool m_timer_stop;                   // protected by |m_timer_mutex|
+  ptr<thread> m_timer_thread;          // protected by |m_timer_mutex|
+
+  // Bumped to wake the timer thread early, e.g for a timer which expires
+  // before the timer thread was going to wake up.
+  atomic<rx_u32> m_timer_signal;
+
   static global<thread_pool> s_instance;
 };
 
+inline constexpr thread_pool::timer::timer()
+  : timer{nullptr, 0}
+{
+}
+
+inline constexpr thread_pool::timer::timer(void* _node, rx_u64 _serial)
+  : m_node{_node}
+  , m_serial{_serial}
+{
+}
+
 inline thread_pool::thread_pool(rx_size _threads, rx_size _static_pool_size)
   : thread_pool{memory::system_allocator::instance(), _threads, _static_pool_size}
 {
 }
 
+inline thread_pool::thread_pool(const vector<rx_size>& _cpus, rx_size _static_pool_size)
+  : thread_pool{memory::system_allocator::instance(), _cpus, _static_pool_size}
+{
+}
+
+RX_HINT_FORCE_INLINE rx_size thread_pool::thread_count() const {
+  return m_queue_count;
+}
+
 RX_HINT_FORCE_INLINE constexpr memory::allocator& thread_pool::allocator() const {
   return m_allocator;
 }
@@ -0,0 +1,123 @@
+#include "rx/core/concurrency/timer_wheel.h"
+#include "rx/core/utility/bit.h" // bit_search_lsb
+
+#include "rx/core/assert.h"
+
+namespace rx::concurrency {
+
+static constexpr const rx_u64 k_slot_mask{timer_wheel::k_slots - 1};
+
+// Number of ticks covered by the entire wheel.
+static constexpr const rx_u64 k_range{1_u64 << (timer_wheel::k_slot_bits * timer_wheel::k_levels)};
+
+static inline rx_size shift(rx_size _level) {
+  return _level * timer_wheel::k_slot_bits;
+}
+
+static inline rx_u64 rotate_right(rx_u64 _bits, rx_size _count) {
+  return _count ? (_bits >> _count) | (_bits << (64 - _count)) : _bits;
+}
+
+void timer_wheel::insert(timer* _timer) {
+  // The slot of the current tick was expired already.
+  if (_timer->deadline <= m_now) {
+    _timer->deadline = m_now + 1;
+  }
+  place(_timer);
+  m_size++;
+}
+
+void timer_wheel::erase(timer* _timer) {
+  auto& slot{m_slots[_timer->m_level][_timer->m_slot]};
+  slot.erase(&_timer->link);
+  if (slot.is_empty()) {
+    m_occupied[_timer->m_level] &= ~(1_u64 << _timer->m_slot);
+  }
+  m_size--;
+}
+
+void timer_wheel::advance(rx_u64 _now, intrusive_list& expired_) {
+  while (m_now < _now) {
+    // Jump straight to the next tick where something happens.
+    const rx_u64 next{next_tick()};
+    if (next > _now) {
+      m_now = _now;
+      break;
+    }
+
+    m_now = next;
+
+    // Cascade the higher levels first so timers can move down more than one
+    // level in the same tick.
+    for (rx_size level{k_levels - 1}; level > 0; level--) {
+      if ((m_now & ((1_u64 << shift(level)) - 1)) == 0) {
+        cascade(level);
+      }
+    }
+
+    const rx_size index{static_cast<rx_size>(m_now & k_slot_mask)};
+    auto& slot{m_slots[0][index]};
+    while (auto node = slot.pop_front()) {
+      expired_.push_back(node);
+      m_size--;
+    }
+    m_occupied[0] &= ~(1_u64 << index);
+  }
+}
+
+rx_u64 timer_wheel::next_tick() const {
+  rx_u64 result{-1_u64};
+  for (rx_size level{0}; level < k_levels; level++) {
+    if (!m_occupied[level]) {
+      continue;
+    }
+
+    // Find the first occupied slot after the current one, wrapping around.
+    // The current slot itself comes last, it holds timers one lap ahead.
+    const rx_u64 position{m_now >> shift(level)};
+    const rx_size first{static_cast<rx_size>((position + 1) & k_slot_mask)};
+    const rx_u64 distance{bit_search_lsb(rotate_right(m_occupied[level], first))};
+
+    // Slots of the lowest level expire on their tick, the slots of the other
+    // levels cascade on the first tick they cover.
+    const rx_u64 tick{(position + 1 + distance) << shift(level)};
+    if (tick < result) {
+      result = tick;
+    }
+  }
+  return result;
+}
+
+void timer_wheel::place(timer* _timer) {
+  const rx_u64 delta{_timer->deadline - m_now};
+
+  rx_size level{0};
+  while (level < k_levels - 1 && delta >= (1_u64 << shift(level + 1))) {
+    level++;
+  }
+
+  // Timers beyond the range of the wheel are kept as far away as it reaches
+  // and placed again when cascaded.
+  const rx_u64 tick{delta < k_range ? _timer->deadline : m_now + k_range - 1};
+  const rx_size slot{static_cast<rx_size>((tick >> shift(level)) & k_slot_mask)};
+
+  _timer->m_level = static_cast<rx_u8>(level);
+  _timer->m_slot = static_cast<rx_u8>(slot);
+  m_slots[level][slot].push_back(&_timer->link);
+  m_occupied[level] |= 1_u64 << slot;
+}
+
+void timer_wheel::cascade(rx_size _level) {
+  const rx_size index{static_cast<rx_size>((m_now >> shift(_level)) & k_slot_mask)};
+  auto& slot{m_slots[_level][index]};
+  intrusive_list timers{utility::move(slot)};
+  m_occupied[_level] &= ~(1_u64 << index);
+
+  while (auto node = timers.pop_front()) {
+    auto item{node->data<timer>(&timer::link)};
+    RX_ASSERT(item->deadline >= m_now, "timer missed");
+    place(item);
+  }
+}
+
+} // namespace rx::concurrency
@@ -0,0 +1,83 @@
+#ifndef RX_CORE_CONCURRENCY_TIMER_WHEEL_H
+#define RX_CORE_CONCURRENCY_TIMER_WHEEL_H
+#include "rx/core/intrusive_list.h"
+
+namespace rx::concurrency {
+
+// # Timer Wheel
+//
+// Hierarchical timing wheel. Time is counted in ticks of whatever resolution
+// the user picks. Timers go in one of |k_slots| slots of one of |k_levels|
+// levels depending on how far away their deadline is. Each level covers
+// |k_slots| times the span of the level below it. Inserting and erasing a
+// timer is O(1).
+//
+// Advancing the wheel expires the timers of the current slot of the lowest
+// level. Whenever a level wraps around the next slot of the level above is
+// cascaded down, its timers are inserted again closer to their deadline.
+// Timers further away than the wheel covers wait in the top level and are
+// cascaded until they fit.
+//
+// The wheel isn't thread safe, timers are owned by the caller.
+struct timer_wheel {
+  static constexpr const rx_size k_levels{4};
+  static constexpr const rx_size k_slot_bits{6};
+  static constexpr const rx_size k_slots{1_z << k_slot_bits};
+
+  struct timer {
+    intrusive_list::node link;
+    rx_u64 deadline; // tick the timer expires on
+  private:
+    friend struct timer_wheel;
+    rx_u8 m_level;
+    rx_u8 m_slot;
+  };
+
+  constexpr timer_wheel(rx_u64 _now);
+
+  // insert |_timer| to expire on |_timer->deadline|, timers with a deadline
+  // which passed already expire on the next tick
+  void insert(timer* _timer);
+
+  // remove |_timer| before it expired
+  void erase(timer* _timer);
+
+  // advance the wheel to tick |_now| and move every timer which expired on
+  // the way to |expired_|
+  void advance(rx_u64 _now, intrusive_list& expired_);
+
+  // the tick the wheel needs to be advanced to next, either because a timer
+  // expires or a level cascades, -1 when there are no timers
+  rx_u64 next_tick() const;
+
+  rx_u64 now() const;
+  rx_size size() const;
+
+private:
+  void place(timer* _timer);
+  void cascade(rx_size _level);
+
+  intrusive_list m_slots[k_levels][k_slots];
+  rx_u64 m_occupied[k_levels]; // bit for every non-empty slot
+  rx_u64 m_now;                // last tick advanced to
+  rx_size m_size;
+};
+
+inline constexpr timer_wheel::timer_wheel(rx_u64 _now)
+  : m_occupied{}
+  , m_now{_now}
+  , m_size{0}
+{
+}
+
+inline rx_u64 timer_wheel::now() const {
+  return m_now;
+}
+
+inline rx_size timer_wheel::size() const {
+  return m_size;
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_TIMER_WHEEL_H
@@ -0,0 +1,297 @@
+#include "rx/core/concurrency/topology.h"
+#include "rx/core/filesystem/file.h"
+
+#include "rx/core/log.h"
+
+#if defined(RX_PLATFORM_LINUX)
+#include <pthread.h> // pthread_{get,set}affinity_np, pthread_self
+#include <sched.h> // cpu_set_t, CPU_{ZERO,SET,ISSET}
+#include <unistd.h> // sysconf, syscall
+#include <sys/syscall.h> // SYS_move_pages
+#elif defined(RX_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h> // GetLogicalProcessorInformation, SetThreadAffinityMask
+#endif
+
+namespace rx::concurrency {
+
+RX_LOG("topology", logger);
+
+#if defined(RX_PLATFORM_LINUX)
+// Read the first line of the sysfs file at |_file_name|.
+static bool read_sysfs(const char* _file_name, string& line_) {
+  filesystem::file file{_file_name, "r"};
+  return file && file.read_line(line_);
+}
+
+// Parse a sysfs list like "0-3,8,10-11" into |list_|.
+static bool parse_list(const string& _list, vector<rx_size>& list_) {
+  const char* ch{_list.data()};
+  while (*ch) {
+    rx_size first{0};
+    if (*ch < '0' || *ch > '9') {
+      return false;
+    }
+    for (; *ch >= '0' && *ch <= '9'; ch++) {
+      first = first * 10 + (*ch - '0');
+    }
+
+    rx_size last{first};
+    if (*ch == '-') {
+      last = 0;
+      for (ch++; *ch >= '0' && *ch <= '9'; ch++) {
+        last = last * 10 + (*ch - '0');
+      }
+    }
+
+    for (rx_size i{first}; i <= last; i++) {
+      if (!list_.push_back(i)) {
+        return false;
+      }
+    }
+
+    if (*ch == ',') {
+      ch++;
+    }
+  }
+  return true;
+}
+
+static bool read_sysfs_list(const char* _file_name, vector<rx_size>& list_) {
+  string line{list_.allocator()};
+  return read_sysfs(_file_name, line) && parse_list(line, list_);
+}
+
+static bool read_sysfs_value(const char* _file_name, rx_size& value_) {
+  string line;
+  return read_sysfs(_file_name, line) && line.scan("%zu", &value_) == 1;
+}
+#endif
+
+topology::topology(memory::allocator& _allocator)
+  : m_allocator{_allocator}
+  , m_logical_cores{1}
+  , m_physical_cores{1}
+  , m_nodes{allocator()}
+{
+#if defined(RX_PLATFORM_LINUX)
+  vector<rx_size> cpus{allocator()};
+  if (!read_sysfs_list("/sys/devices/system/cpu/online", cpus) || cpus.is_empty()) {
+    detect_fallback();
+    return;
+  }
+
+  m_logical_cores = cpus.size();
+
+  // Hyper-threads of the same physical core share the core and package ids.
+  vector<rx_u64> cores{allocator()};
+  cpus.each_fwd([&](rx_size _cpu) {
+    rx_size core_id{_cpu};
+    rx_size package_id{0};
+    const auto core_file{string::format("/sys/devices/system/cpu/cpu%zu/topology/core_id", _cpu)};
+    const auto package_file{string::format("/sys/devices/system/cpu/cpu%zu/topology/physical_package_id", _cpu)};
+    read_sysfs_value(core_file.data(), core_id);
+    read_sysfs_value(package_file.data(), package_id);
+    const rx_u64 key{(static_cast<rx_u64>(package_id) << 32) | core_id};
+    if (cores.find(key) == vector<rx_u64>::k_npos) {
+      cores.push_back(key);
+    }
+  });
+
+  m_physical_cores = cores.is_empty() ? m_logical_cores : cores.size();
+
+  vector<rx_size> nodes{allocator()};
+  if (read_sysfs_list("/sys/devices/system/node/online", nodes)) {
+    nodes.each_fwd([&](rx_size _node) {
+      const auto cpu_file{string::format("/sys/devices/system/node/node%zu/cpulist", _node)};
+      node entry{allocator(), _node};
+      // Memory only nodes have no cpus and cannot run a sub-pool.
+      if (read_sysfs_list(cpu_file.data(), entry.cpus) && !entry.cpus.is_empty()) {
+        m_nodes.push_back(utility::move(entry));
+      }
+    });
+  }
+
+  // Kernels without NUMA support still have a single node.
+  if (m_nodes.is_empty()) {
+    node entry{allocator(), 0};
+    entry.cpus = utility::move(cpus);
+    m_nodes.push_back(utility::move(entry));
+  }
+#elif defined(RX_PLATFORM_WINDOWS)
+  DWORD length{0};
+  GetLogicalProcessorInformation(nullptr, &length);
+
+  auto data = allocator().allocate(length);
+  auto info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION*>(data);
+  if (!data || !GetLogicalProcessorInformation(info, &length)) {
+    allocator().deallocate(data);
+    detect_fallback();
+    return;
+  }
+
+  // Only the first 64 logical cores of the calling thread's group are visible.
+  auto each_cpu = [](ULONG_PTR _mask, auto&& _function) {
+    for (rx_size i{0}; i < sizeof _mask * 8; i++) {
+      if (_mask & (static_cast<ULONG_PTR>(1) << i)) {
+        _function(i);
+      }
+    }
+  };
+
+  m_logical_cores = 0;
+  m_physical_cores = 0;
+  const rx_size count{length / sizeof *info};
+  for (rx_size i{0}; i < count; i++) {
+    switch (info[i].Relationship) {
+    case RelationProcessorCore:
+      m_physical_cores++;
+      each_cpu(info[i].ProcessorMask, [&](rx_size) { m_logical_cores++; });
+      break;
+    case RelationNumaNode:
+      {
+        node entry{allocator(), info[i].NumaNode.NodeNumber};
+        each_cpu(info[i].ProcessorMask, [&](rx_size _cpu) {
+          entry.cpus.push_back(_cpu);
+        });
+        if (!entry.cpus.is_empty()) {
+          m_nodes.push_back(utility::move(entry));
+        }
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  allocator().deallocate(data);
+
+  if (m_logical_cores == 0 || m_nodes.is_empty()) {
+    detect_fallback();
+    return;
+  }
+#else
+  detect_fallback();
+  return;
+#endif
+
+  logger->info("%zu logical cores, %zu physical cores, %zu nodes",
+    m_logical_cores, m_physical_cores, m_nodes.size());
+}
+
+void topology::detect_fallback() {
+#if defined(RX_PLATFORM_POSIX)
+  const long cpus{sysconf(_SC_NPROCESSORS_ONLN)};
+  m_logical_cores = cpus > 0 ? static_cast<rx_size>(cpus) : 1;
+#else
+  m_logical_cores = 1;
+#endif
+  m_physical_cores = m_logical_cores;
+
+  m_nodes.clear();
+  node entry{allocator(), 0};
+  for (rx_size i{0}; i < m_logical_cores; i++) {
+    entry.cpus.push_back(i);
+  }
+  m_nodes.push_back(utility::move(entry));
+
+  logger->warning("topology detection unsupported, assuming %zu cores",
+    m_logical_cores);
+}
+
+rx_size topology::node_of(const void* _data) const {
+#if defined(RX_PLATFORM_LINUX)
+  // Querying the page with move_pages and no target nodes reports the node
+  // it's on without moving it.
+  const long page_size{sysconf(_SC_PAGESIZE)};
+  void* page{reinterpret_cast<void*>(reinterpret_cast<rx_uintptr>(_data)
+    & ~static_cast<rx_uintptr>(page_size - 1))};
+  int status{-1};
+  if (syscall(SYS_move_pages, 0, 1, &page, nullptr, &status, 0) != 0 || status < 0) {
+    return -1_z;
+  }
+
+  return m_nodes.find_if([status](const node& _node) {
+    return _node.id == static_cast<rx_size>(status);
+  });
+#else
+  (void)_data;
+  return -1_z;
+#endif
+}
+
+rx_size topology::node_of_cpu(rx_size _cpu) const {
+  return m_nodes.find_if([_cpu](const node& _node) {
+    return _node.cpus.find(_cpu) != vector<rx_size>::k_npos;
+  });
+}
+
+bool topology::set_affinity(const vector<rx_size>& _cpus) {
+#if defined(RX_PLATFORM_LINUX)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  _cpus.each_fwd([&](rx_size _cpu) {
+    if (_cpu < CPU_SETSIZE) {
+      CPU_SET(_cpu, &set);
+    }
+  });
+  return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+#elif defined(RX_PLATFORM_WINDOWS)
+  DWORD_PTR mask{0};
+  _cpus.each_fwd([&](rx_size _cpu) {
+    if (_cpu < sizeof mask * 8) {
+      mask |= static_cast<DWORD_PTR>(1) << _cpu;
+    }
+  });
+  return mask && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+  (void)_cpus;
+  return false;
+#endif
+}
+
+bool topology::set_affinity(rx_size _cpu) {
+  vector<rx_size> cpus;
+  return cpus.push_back(_cpu) && set_affinity(cpus);
+}
+
+bool topology::affinity(vector<rx_size>& cpus_) {
+  cpus_.clear();
+#if defined(RX_PLATFORM_LINUX)
+  cpu_set_t set;
+  if (pthread_getaffinity_np(pthread_self(), sizeof set, &set) != 0) {
+    return false;
+  }
+  for (rx_size i{0}; i < CPU_SETSIZE; i++) {
+    if (CPU_ISSET(i, &set) && !cpus_.push_back(i)) {
+      return false;
+    }
+  }
+  return true;
+#elif defined(RX_PLATFORM_WINDOWS)
+  // There's no query for the affinity of a thread, set it to the one of the
+  // process to read the previous one and restore it.
+  DWORD_PTR process_mask;
+  DWORD_PTR system_mask;
+  if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+    return false;
+  }
+  const auto thread = GetCurrentThread();
+  const DWORD_PTR mask{SetThreadAffinityMask(thread, process_mask)};
+  if (!mask) {
+    return false;
+  }
+  SetThreadAffinityMask(thread, mask);
+  for (rx_size i{0}; i < sizeof mask * 8; i++) {
+    if ((mask & (static_cast<DWORD_PTR>(1) << i)) && !cpus_.push_back(i)) {
+      return false;
+    }
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // namespace rx::concurrency
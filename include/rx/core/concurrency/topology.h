@@ -0,0 +1,86 @@
+#ifndef RX_CORE_CONCURRENCY_TOPOLOGY_H
+#define RX_CORE_CONCURRENCY_TOPOLOGY_H
+#include "rx/core/vector.h"
+
+namespace rx::concurrency {
+
+// # Topology
+//
+// Describes the processors of the machine: the number of logical and physical
+// cores and how the logical cores are grouped into NUMA nodes. The topology is
+// detected when constructed.
+//
+// When detection isn't supported the machine is described as a single node
+// with every logical core, without hyper-threading.
+struct topology {
+  struct node {
+    node(memory::allocator& _allocator, rx_size _id);
+
+    rx_size id;
+    vector<rx_size> cpus; // logical cores in this node
+  };
+
+  topology(memory::allocator& _allocator);
+  topology();
+
+  rx_size logical_cores() const;
+  rx_size physical_cores() const;
+
+  const vector<node>& nodes() const;
+
+  // the index into |nodes| of the node the memory at |_data| resides on or -1
+  // when it isn't known, e.g because the memory wasn't touched yet
+  rx_size node_of(const void* _data) const;
+
+  // the index into |nodes| of the node containing |_cpu| or -1
+  rx_size node_of_cpu(rx_size _cpu) const;
+
+  constexpr memory::allocator& allocator() const;
+
+  // restrict the calling thread to run on |_cpus|, returns false when that
+  // isn't supported
+  static bool set_affinity(const vector<rx_size>& _cpus);
+  static bool set_affinity(rx_size _cpu);
+
+  // the cpus the calling thread is allowed to run on
+  static bool affinity(vector<rx_size>& cpus_);
+
+private:
+  void detect_fallback();
+
+  ref<memory::allocator> m_allocator;
+  rx_size m_logical_cores;
+  rx_size m_physical_cores;
+  vector<node> m_nodes;
+};
+
+inline topology::node::node(memory::allocator& _allocator, rx_size _id)
+  : id{_id}
+  , cpus{_allocator}
+{
+}
+
+inline topology::topology()
+  : topology{memory::system_allocator::instance()}
+{
+}
+
+inline rx_size topology::logical_cores() const {
+  return m_logical_cores;
+}
+
+inline rx_size topology::physical_cores() const {
+  return m_physical_cores;
+}
+
+inline const vector<topology::node>& topology::nodes() const {
+  return m_nodes;
+}
+
+RX_HINT_FORCE_INLINE constexpr memory::allocator& topology::allocator() const {
+  return m_allocator;
+}
+
+} // namespace rx::concurrency
+
+#endif // RX_CORE_CONCURRENCY_TOPOLOGY_H
@@ -1,17 +1,25 @@
 #include "rx/core/concurrency/wait_group.h"
-#include "rx/core/concurrency/scope_lock.h"
+
+#include "rx/core/assert.h"
 
 namespace rx::concurrency {
 
 void wait_group::signal() {
-  scope_lock lock{m_mutex};
-  m_signaled_count++;
-  m_condition_variable.signal();
+  const rx_u32 count{m_count.fetch_sub(1, memory_order::k_acq_rel)};
+  RX_ASSERT(count, "signaled too many times");
+  if (count == 1) {
+    // The waiters may destroy the group as soon as they see the count reach
+    // zero, waking only uses its address and never touches the memory.
+    m_count.notify_all();
+  }
 }
 
 void wait_group::wait() {
-  scope_lock lock{m_mutex};
-  m_condition_variable.wait(lock, [&]{ return m_signaled_count == m_count; });
+  for (rx_u32 count{m_count.load(memory_order::k_acquire)}; count;
+    count = m_count.load(memory_order::k_acquire))
+  {
+    m_count.wait(count, memory_order::k_acquire);
+  }
 }
 
 } // namespace rx::concurrency
@@ -2,11 +2,15 @@
 #define RX_CORE_CONCURRENCY_WAIT_GROUP_H
 #include "rx/core/types.h"
 
-#include "rx/core/concurrency/mutex.h"
-#include "rx/core/concurrency/condition_variable.h"
+#include "rx/core/concurrency/atomic.h"
 
 namespace rx::concurrency {
 
+// # Wait Group
+//
+// Waits for |_count| signals. The group is a single atomic counter of the
+// signals still outstanding. Signalling is lock-free, only the last signal
+// wakes the waiting threads, which sleep on the counter.
 struct wait_group {
   wait_group(rx_size _count);
   wait_group();
@@ -15,15 +19,11 @@ struct wait_group {
   void wait();
 
 private:
-  rx_size m_signaled_count; // protected by |m_mutex|
-  rx_size m_count;          // protected by |m_mutex|
-  mutex m_mutex;
-  condition_variable m_condition_variable;
+  atomic<rx_u32> m_count;
 };
 
 inline wait_group::wait_group(rx_size _count)
-  : m_signaled_count{0}
-  , m_count{_count}
+  : m_count{static_cast<rx_u32>(_count)}
 {
 }
 
@@ -1,10 +1,35 @@
 #ifndef RX_CORE_CONCURRENCY_YIELD_H
 #define RX_CORE_CONCURRENCY_YIELD_H
+#include "rx/core/config.h" // RX_COMPILER_{GCC,CLANG,MSVC}
+
+#if defined(RX_COMPILER_MSVC)
+#include <intrin.h> // _mm_pause, __yield
+#endif
 
 namespace rx::concurrency {
 
+// give up the remainder of the calling thread's time slice
 void yield();
 
+// hint to the processor that the calling thread is in a spin-wait loop, this
+// reduces the power used and the penalty of leaving the loop without giving up
+// the time slice
+inline void pause() {
+#if defined(RX_COMPILER_GCC) || defined(RX_COMPILER_CLANG)
+# if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+# elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+# endif
+#elif defined(RX_COMPILER_MSVC)
+# if defined(_M_X64) || defined(_M_IX86)
+  _mm_pause();
+# elif defined(_M_ARM64) || defined(_M_ARM)
+  __yield();
+# endif
+#endif
+}
+
 } // namespace rx::concurrency
 
-#endif // RX_CORE_CONCURRENCY_YIELD_H
\ No newline at end of file
+#endif // RX_CORE_CONCURRENCY_YIELD_H
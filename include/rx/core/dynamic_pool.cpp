@@ -4,38 +4,173 @@ namespace rx {
 
 dynamic_pool::dynamic_pool(dynamic_pool&& pool_)
   : m_allocator{pool_.m_allocator}
+  , m_object_size{utility::exchange(pool_.m_object_size, 0)}
+  , m_objects_per_pool{utility::exchange(pool_.m_objects_per_pool, 0)}
   , m_pools{utility::move(pool_.m_pools)}
+  , m_free_links{utility::move(pool_.m_free_links)}
+  , m_free_head{utility::exchange(pool_.m_free_head, -1_z)}
+  , m_sorted_pools{utility::move(pool_.m_sorted_pools)}
 {
 }
 
 dynamic_pool& dynamic_pool::operator=(dynamic_pool&& pool_) {
+  RX_ASSERT(&pool_ != this, "self assignment");
+
   m_allocator = pool_.m_allocator;
+  m_object_size = utility::exchange(pool_.m_object_size, 0);
+  m_objects_per_pool = utility::exchange(pool_.m_objects_per_pool, 0);
   m_pools = utility::move(pool_.m_pools);
+  m_free_links = utility::move(pool_.m_free_links);
+  m_free_head = utility::exchange(pool_.m_free_head, -1_z);
+  m_sorted_pools = utility::move(pool_.m_sorted_pools);
+
   return *this;
 }
 
-rx_size dynamic_pool::pool_index_of(const rx_byte* _data) const {
-  return m_pools.find_if([_data](const ptr<static_pool>& _pool) {
-    return _pool->owns(_data);
-  });
+rx_size dynamic_pool::allocate() {
+  if (m_free_head == -1_z && !add_pool()) {
+    return -1_z;
+  }
+
+  const rx_size pool_index{m_free_head};
+  auto& pool{m_pools[pool_index]};
+
+  const rx_size object_index{pool->allocate()};
+  if (!pool->can_allocate()) {
+    unlink_free(pool_index);
+  }
+
+  return pool_index * m_objects_per_pool + object_index;
+}
+
+void dynamic_pool::deallocate(rx_size _index) {
+  const rx_size pool_index{_index / m_objects_per_pool};
+  auto& pool{m_pools[pool_index]};
+
+  if (!pool->can_allocate()) {
+    link_free(pool_index);
+  }
+
+  pool->deallocate(_index % m_objects_per_pool);
+
+  // When the pool is empty and at the end, release the empty pools at the end
+  // to reduce memory, all but one which is kept as a spare.
+  if (pool->is_empty() && pool_index + 2 >= m_pools.size()) {
+    while (m_pools.size() >= 2 && m_pools.last()->is_empty()
+      && m_pools[m_pools.size() - 2]->is_empty())
+    {
+      remove_last_pool();
+    }
+  }
 }
 
 rx_byte* dynamic_pool::data_of(rx_size _index) const {
-  const rx_size pool_index = _index / m_pools.size();
-  const rx_size object_index = _index % m_pools.size();
+  const rx_size pool_index{_index / m_objects_per_pool};
+  const rx_size object_index{_index % m_objects_per_pool};
   return m_pools[pool_index]->data_of(object_index);
 }
 
 rx_size dynamic_pool::index_of(const rx_byte* _data) const {
   if (const rx_size index = pool_index_of(_data); index != -1_z) {
-    return index * m_pools.size();
+    return index * m_objects_per_pool + m_pools[index]->index_of(_data);
   }
   return -1_z;
 }
 
+rx_size dynamic_pool::pool_index_of(const rx_byte* _data) const {
+  // Find the last pool starting at or before |_data|.
+  rx_size first{0};
+  rx_size last{m_sorted_pools.size()};
+  while (first < last) {
+    const rx_size middle{first + (last - first) / 2};
+    if (m_sorted_pools[middle].data <= _data) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+
+  if (first == 0) {
+    return -1_z;
+  }
+
+  const rx_size index{m_sorted_pools[first - 1].index};
+  return index < m_pools.size() && m_pools[index]->owns(_data) ? index : -1_z;
+}
+
 bool dynamic_pool::add_pool() {
+  const rx_size pools{m_pools.size()};
+
+  // Drop the entries of released pools, the new pool may reuse their memory.
+  if (m_sorted_pools.size() > pools) {
+    rx_size kept{0};
+    for (rx_size i{0}; i < m_sorted_pools.size(); i++) {
+      if (m_sorted_pools[i].index < pools) {
+        m_sorted_pools[kept++] = m_sorted_pools[i];
+      }
+    }
+    m_sorted_pools.erase(kept, m_sorted_pools.size());
+  }
+
+  if (!m_pools.reserve(pools + 1) || !m_free_links.reserve(pools + 1)
+    || !m_sorted_pools.reserve(pools + 1))
+  {
+    return false;
+  }
+
   auto pool = make_ptr<static_pool>(allocator(), allocator(), m_object_size, m_objects_per_pool);
-  return pool ? m_pools.push_back(utility::move(pool)) : false;
+  if (!pool) {
+    return false;
+  }
+
+  // Insert it in address order.
+  const rx_byte* data{pool->data()};
+  rx_size position{pools};
+  m_sorted_pools.push_back({data, pools});
+  for (; position > 0 && m_sorted_pools[position - 1].data > data; position--) {
+    m_sorted_pools[position] = m_sorted_pools[position - 1];
+  }
+  m_sorted_pools[position] = {data, pools};
+
+  m_pools.push_back(utility::move(pool));
+  m_free_links.push_back({-1_z, -1_z});
+  link_free(pools);
+
+  return true;
+}
+
+void dynamic_pool::remove_last_pool() {
+  const rx_size index{m_pools.size() - 1};
+
+  if (m_pools[index]->can_allocate()) {
+    unlink_free(index);
+  }
+
+  // The entry in |m_sorted_pools| is left for |add_pool| to drop.
+  m_free_links.pop_back();
+  m_pools.pop_back();
+}
+
+void dynamic_pool::link_free(rx_size _pool_index) {
+  auto& link{m_free_links[_pool_index]};
+  link.prev = -1_z;
+  link.next = m_free_head;
+  if (m_free_head != -1_z) {
+    m_free_links[m_free_head].prev = _pool_index;
+  }
+  m_free_head = _pool_index;
+}
+
+void dynamic_pool::unlink_free(rx_size _pool_index) {
+  auto& link{m_free_links[_pool_index]};
+  if (link.prev != -1_z) {
+    m_free_links[link.prev].next = link.next;
+  } else {
+    m_free_head = link.next;
+  }
+  if (link.next != -1_z) {
+    m_free_links[link.next].prev = link.prev;
+  }
 }
 
 } // namespace rx
@@ -8,6 +8,21 @@
 
 namespace rx {
 
+// # Dynamic Pool
+//
+// Growing pool of equally sized objects, made of static pools of
+// |_objects_per_pool| objects each which are added as needed. An object is
+// referred to by the index of its pool times the objects per pool plus its
+// index in that pool.
+//
+// Pools with free space are kept in a list so allocating never looks at a full
+// pool, and the pools are kept sorted by address so the pool of an object is
+// found with a binary search.
+//
+// Empty pools at the end are released, except for one kept as a spare so that
+// allocating and deallocating across the end of the last pool doesn't make and
+// release a pool every time. Released pools are left in the sorted pools and
+// only removed from them when the next pool is added.
 struct RX_HINT_EMPTY_BASES dynamic_pool
   : concepts::no_copy
 {
@@ -37,12 +52,35 @@ struct RX_HINT_EMPTY_BASES dynamic_pool
 
 private:
   [[nodiscard]] bool add_pool();
+  void remove_last_pool();
   rx_size pool_index_of(const rx_byte* _data) const;
 
+  void link_free(rx_size _pool_index);
+  void unlink_free(rx_size _pool_index);
+
+  struct free_link {
+    rx_size prev;
+    rx_size next;
+  };
+
   ref<memory::allocator> m_allocator;
   rx_size m_object_size;
   rx_size m_objects_per_pool;
   vector<ptr<static_pool>> m_pools;
+
+  // Pools with free space, linked through the entry of every pool. The head is
+  // -1_z when every pool is full.
+  vector<free_link> m_free_links;
+  rx_size m_free_head;
+
+  struct sorted_pool {
+    const rx_byte* data;
+    rx_size index;
+  };
+
+  // Pools ordered by the address of their objects. Entries with an index past
+  // the end of |m_pools| are of released pools, none of which overlap a pool.
+  vector<sorted_pool> m_sorted_pools;
 };
 
 inline constexpr dynamic_pool::dynamic_pool(memory::allocator& _allocator, rx_size _object_size, rx_size _objects_per_pool)
@@ -50,6 +88,9 @@ inline constexpr dynamic_pool::dynamic_pool(memory::allocator& _allocator, rx_si
   , m_object_size{_object_size}
   , m_objects_per_pool{_objects_per_pool}
   , m_pools{allocator()}
+  , m_free_links{allocator()}
+  , m_free_head{-1_z}
+  , m_sorted_pools{allocator()}
 {
 }
 
@@ -64,38 +105,27 @@ RX_HINT_FORCE_INLINE rx_byte* dynamic_pool::operator[](rx_size _index) const {
 
 template<typename T, typename... Ts>
 inline T* dynamic_pool::create(Ts&&... _arguments) {
-  const rx_size pools = m_pools.size();
-  for (rx_size i = 0; i < pools; i++) {
-    auto& pool = m_pools[i];
-    if (pool->can_allocate()) {
-      return pool->create<T>(utility::forward<Ts>(_arguments)...);
-    }
-  }
+  RX_ASSERT(sizeof(T) <= m_object_size, "object too large (%zu > %zu)",
+    sizeof(T), m_object_size);
 
-  if (add_pool()) {
-    return create<T>(utility::forward<Ts>(_arguments)...);
+  const rx_size index{allocate()};
+  if (RX_HINT_UNLIKELY(index == -1_z)) {
+    return nullptr;
   }
 
-  return nullptr;
+  return utility::construct<T>(data_of(index),
+    utility::forward<Ts>(_arguments)...);
 }
 
 template<typename T>
 void dynamic_pool::destroy(T* _data) {
-  const rx_size index = pool_index_of(reinterpret_cast<const rx_byte*>(_data));
+  const rx_size index{index_of(reinterpret_cast<const rx_byte*>(_data))};
   if (index == -1_z) {
     return;
   }
 
-  // Fetch the static pool with the given index, then destroy the data on
-  // that pool, as it own's it.
-  auto& pool = m_pools[index];
-  pool->destroy<T>(_data);
-
-  // When the pool is empty and it's the last pool in the list, to reduce
-  // memory, remove it from |m_pools|.
-  if (pool->is_empty() && pool == m_pools.last()) {
-    m_pools.pop_back();
-  }
+  utility::destruct<T>(_data);
+  deallocate(index);
 }
 
 RX_HINT_FORCE_INLINE constexpr memory::allocator& dynamic_pool::allocator() const {
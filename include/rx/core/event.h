@@ -3,8 +3,10 @@
 #include "rx/core/function.h"
 #include "rx/core/vector.h"
 
+#include "rx/core/concurrency/atomic.h"
 #include "rx/core/concurrency/spin_lock.h"
 #include "rx/core/concurrency/scope_lock.h"
+#include "rx/core/concurrency/yield.h"
 
 #include "rx/core/hints/empty_bases.h"
 
@@ -15,6 +17,20 @@ namespace rx {
 template<typename T>
 struct event;
 
+// # Event
+//
+// Delegates connected to an event are called, in the order they were
+// connected, every time the event is signalled.
+//
+// The delegates are kept in an immutable, reference counted snapshot. Signals
+// take a reference to the current snapshot and call the delegates without
+// holding any lock, so a slow delegate doesn't hold up other threads and a
+// delegate may connect or disconnect delegates, even on the same event.
+//
+// Connecting and disconnecting copies the snapshot, makes the change and
+// publishes the copy. The previous snapshot is freed by the last signal still
+// using it. A delegate which was disconnected may still be called by signals
+// which began before it was disconnected.
 template<typename R, typename... Ts>
 struct event<R(Ts...)> {
   using delegate = function<R(Ts...)>;
@@ -32,6 +48,7 @@ struct event<R(Ts...)> {
 
   constexpr event(memory::allocator& _allocator);
   constexpr event();
+  ~event();
 
   void signal(Ts... _arguments);
   handle connect(delegate&& function_);
@@ -43,8 +60,32 @@ struct event<R(Ts...)> {
 
 private:
   friend struct handle;
-  mutable concurrency::spin_lock m_lock;
-  vector<delegate> m_delegates; // protected by |m_lock|
+
+  struct snapshot {
+    snapshot(memory::allocator& _allocator, const vector<delegate>& _delegates);
+    snapshot(memory::allocator& _allocator);
+
+    concurrency::atomic<rx_size> references;
+    vector<delegate> delegates; // empty delegates are disconnected
+  };
+
+  snapshot* acquire() const;
+  void release(snapshot* _snapshot) const;
+  void publish(snapshot* _snapshot);
+  void disconnect(rx_size _index);
+
+  ref<memory::allocator> m_allocator;
+
+  // Serializes connecting and disconnecting, never held while signalling.
+  concurrency::spin_lock m_lock;
+
+  // The snapshot is written with |m_lock| held.
+  concurrency::atomic<snapshot*> m_snapshot;
+
+  // Number of threads between loading |m_snapshot| and taking a reference to
+  // it, counted in one of two phases so that waiting for them can't starve.
+  mutable concurrency::atomic<rx_u32> m_phase;
+  mutable concurrency::atomic<rx_size> m_acquiring[2];
 };
 
 template<typename R, typename... Ts>
@@ -64,14 +105,31 @@ inline constexpr event<R(Ts...)>::handle::handle(handle&& handle_)
 template<typename R, typename... Ts>
 inline event<R(Ts...)>::handle::~handle() {
   if (m_event) {
-    concurrency::scope_lock lock{m_event->m_lock};
-    m_event->m_delegates[m_index] = nullptr;
+    m_event->disconnect(m_index);
   }
 }
 
+template<typename R, typename... Ts>
+inline event<R(Ts...)>::snapshot::snapshot(memory::allocator& _allocator,
+  const vector<delegate>& _delegates)
+  : references{1}
+  , delegates{_allocator, _delegates}
+{
+}
+
+template<typename R, typename... Ts>
+inline event<R(Ts...)>::snapshot::snapshot(memory::allocator& _allocator)
+  : references{1}
+  , delegates{_allocator}
+{
+}
+
 template<typename R, typename... Ts>
 inline constexpr event<R(Ts...)>::event(memory::allocator& _allocator)
-  : m_delegates{_allocator}
+  : m_allocator{_allocator}
+  , m_snapshot{nullptr}
+  , m_phase{0}
+  , m_acquiring{0_z, 0_z}
 {
 }
 
@@ -81,27 +139,74 @@ inline constexpr event<R(Ts...)>::event()
 {
 }
 
+template<typename R, typename... Ts>
+inline event<R(Ts...)>::~event() {
+  release(m_snapshot.load(concurrency::memory_order::k_relaxed));
+}
+
 template<typename R, typename... Ts>
 inline void event<R(Ts...)>::signal(Ts... _arguments) {
-  concurrency::scope_lock lock{m_lock};
-  m_delegates.each_fwd([&](delegate& _delegate) {
+  snapshot* current{acquire()};
+  if (!current) {
+    return;
+  }
+
+  current->delegates.each_fwd([&](const delegate& _delegate) {
     if (_delegate) {
       _delegate(_arguments...);
     }
   });
+
+  release(current);
 }
 
 template<typename R, typename... Ts>
 inline typename event<R(Ts...)>::handle event<R(Ts...)>::connect(delegate&& delegate_) {
   concurrency::scope_lock lock{m_lock};
-  const rx_size delegates{m_delegates.size()};
-  for (rx_size i{0}; i < delegates; i++) {
-    if (!m_delegates[i]) {
-      return {this, i};
-    }
+
+  snapshot* current{m_snapshot.load(concurrency::memory_order::k_relaxed)};
+  snapshot* next{current
+    ? allocator().template create<snapshot>(allocator(), current->delegates)
+    : allocator().template create<snapshot>(allocator())};
+  RX_ASSERT(next, "out of memory");
+
+  // Reuse the slot of a disconnected delegate to keep the snapshot compact.
+  auto& delegates{next->delegates};
+  rx_size index{delegates.find_if([](const delegate& _delegate) {
+    return !_delegate;
+  })};
+
+  if (index == vector<delegate>::k_npos) {
+    index = delegates.size();
+    delegates.emplace_back(utility::move(delegate_));
+  } else {
+    delegates[index] = utility::move(delegate_);
   }
-  m_delegates.emplace_back(utility::move(delegate_));
-  return {this, delegates};
+
+  publish(next);
+  return {this, index};
+}
+
+template<typename R, typename... Ts>
+inline void event<R(Ts...)>::disconnect(rx_size _index) {
+  concurrency::scope_lock lock{m_lock};
+
+  snapshot* current{m_snapshot.load(concurrency::memory_order::k_relaxed)};
+  RX_ASSERT(current, "not connected");
+
+  // Publish no snapshot at all once the last delegate is disconnected.
+  const bool last{current->delegates.find_if([&](const delegate& _delegate) {
+    return _delegate && &_delegate != &current->delegates[_index];
+  }) == vector<delegate>::k_npos};
+
+  snapshot* next{nullptr};
+  if (!last) {
+    next = allocator().template create<snapshot>(allocator(), current->delegates);
+    RX_ASSERT(next, "out of memory");
+    next->delegates[_index] = nullptr;
+  }
+
+  publish(next);
 }
 
 template<typename R, typename... Ts>
@@ -111,20 +216,69 @@ inline bool event<R(Ts...)>::is_empty() const {
 
 template<typename R, typename... Ts>
 inline rx_size event<R(Ts...)>::size() const {
-  concurrency::scope_lock lock{m_lock};
-  // This is slightly annoying because |m_delegates| may have empty slots.
+  snapshot* current{acquire()};
+  if (!current) {
+    return 0;
+  }
+
+  // This is slightly annoying because the snapshot may have empty slots.
   rx_size result = 0;
-  m_delegates.each_fwd([&](const delegate& _delegate) {
+  current->delegates.each_fwd([&](const delegate& _delegate) {
     if (_delegate) {
       result++;
     }
   });
+
+  release(current);
   return result;
 }
 
+template<typename R, typename... Ts>
+inline typename event<R(Ts...)>::snapshot* event<R(Ts...)>::acquire() const {
+  using concurrency::memory_order;
+
+  const rx_u32 phase{m_phase.load(memory_order::k_seq_cst) & 1};
+  m_acquiring[phase].fetch_add(1, memory_order::k_seq_cst);
+  snapshot* current{m_snapshot.load(memory_order::k_seq_cst)};
+  if (current) {
+    current->references.fetch_add(1, memory_order::k_relaxed);
+  }
+  m_acquiring[phase].fetch_sub(1, memory_order::k_release);
+
+  return current;
+}
+
+template<typename R, typename... Ts>
+inline void event<R(Ts...)>::release(snapshot* _snapshot) const {
+  using concurrency::memory_order;
+  if (_snapshot && _snapshot->references.fetch_sub(1, memory_order::k_acq_rel) == 1) {
+    allocator().template destroy<snapshot>(_snapshot);
+  }
+}
+
+template<typename R, typename... Ts>
+inline void event<R(Ts...)>::publish(snapshot* _snapshot) {
+  using concurrency::memory_order;
+
+  snapshot* previous{m_snapshot.exchange(_snapshot, memory_order::k_seq_cst)};
+
+  // Threads which loaded |previous| may not have taken their reference yet.
+  // They're counted in either phase, flip each one out of use in turn and wait
+  // for it to drain. Threads arriving meanwhile count in the other phase and
+  // see the new snapshot. The wait never spans a delegate call.
+  for (rx_size i{0}; i < 2; i++) {
+    const rx_u32 phase{m_phase.fetch_add(1, memory_order::k_seq_cst) & 1};
+    while (m_acquiring[phase].load(memory_order::k_acquire)) {
+      concurrency::pause();
+    }
+  }
+
+  release(previous);
+}
+
 template<typename R, typename... Ts>
 RX_HINT_FORCE_INLINE constexpr memory::allocator& event<R(Ts...)>::allocator() const {
-  return m_delegates.allocator();
+  return m_allocator;
 }
 
 } // namespace rx
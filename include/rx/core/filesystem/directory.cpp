@@ -74,7 +74,7 @@ directory::~directory() {
 #endif
 }
 
-void directory::each(function<void(item&&)>&& _function) {
+void directory::each(function_ref<void(item&&)> _function) {
   RX_ASSERT(m_impl, "directory not opened");
 
 #if defined(RX_PLATFORM_POSIX)
@@ -1,7 +1,7 @@
 #ifndef RX_CORE_FILESYSTEM_DIRECTORY_H
 #define RX_CORE_FILESYSTEM_DIRECTORY_H
 #include "rx/core/string.h"
-#include "rx/core/function.h"
+#include "rx/core/function_ref.h"
 
 #include "rx/core/concepts/no_copy.h"
 
@@ -44,7 +44,7 @@ struct RX_HINT_EMPTY_BASES directory
 
   // enumerate directory with |_function| being called for each item
   // NOTE: does not consider hidden files, symbolic links, block devices, or ..
-  void each(function<void(item&&)>&& _function);
+  void each(function_ref<void(item&&)> _function);
 
   const string& path() const &;
 
@@ -1,30 +1,59 @@
 #ifndef RX_CORE_FUNCTION_H
 #define RX_CORE_FUNCTION_H
+#include <string.h> // memcpy
+
 #include "rx/core/ref.h"
 
 #include "rx/core/memory/system_allocator.h"
 
 #include "rx/core/traits/is_callable.h"
+#include "rx/core/traits/is_same.h"
+#include "rx/core/traits/is_trivially_copyable.h"
+#include "rx/core/traits/remove_cvref.h"
 #include "rx/core/traits/enable_if.h"
 
 #include "rx/core/utility/exchange.h"
 
+// Size in bytes of the storage |function| keeps inline, callables which fit are
+// stored without an allocation. Must be the same for every translation unit,
+// set it with the RX_FUNCTION_INLINE_SIZE CMake option.
+#if !defined(RX_FUNCTION_INLINE_SIZE)
+#define RX_FUNCTION_INLINE_SIZE 48
+#endif
+
 namespace rx {
 
-// 32-bit: 12 bytes
-// 64-bit: 24 bytes
+// # Function
+//
+// Type-erased callable.
+//
+// Callables of up to |k_inline_size| bytes which need no more alignment than
+// |memory::allocator::k_alignment| are stored inline, which covers captureless
+// lambdas and lambdas capturing a few pointers or references. Only larger
+// callables are allocated from the allocator. Trivially copyable callables are
+// copied and moved with a plain memcpy.
+//
+// Moving a function with an inline callable moves the callable, moving one with
+// an allocated callable only moves the pointer to it.
+//
+// 32-bit: 8 bytes + |k_inline_size|
+// 64-bit: 16 bytes + |k_inline_size|
 template<typename T>
 struct function;
 
 template<typename R, typename... Ts>
 struct function<R(Ts...)> {
+  static constexpr const rx_size k_inline_size{RX_FUNCTION_INLINE_SIZE};
+
   constexpr function(memory::allocator& _allocator);
   constexpr function();
 
-  template<typename F, typename = traits::enable_if<traits::is_callable<F, Ts...>>>
+  template<typename F, typename = traits::enable_if<traits::is_callable<F, Ts...>
+    && !traits::is_same<traits::remove_cvref<F>, function>>>
   function(memory::allocator& _allocator, F&& _function);
 
-  template<typename F, typename = traits::enable_if<traits::is_callable<F, Ts...>>>
+  template<typename F, typename = traits::enable_if<traits::is_callable<F, Ts...>
+    && !traits::is_same<traits::remove_cvref<F>, function>>>
   function(F&& _function);
 
   function(const function& _function);
@@ -43,65 +72,95 @@ struct function<R(Ts...)> {
   constexpr memory::allocator& allocator() const;
 
 private:
+  static_assert(k_inline_size >= sizeof(rx_byte*) && k_inline_size % sizeof(rx_byte*) == 0,
+    "invalid inline size");
+
   enum class lifetime {
-    k_construct,
+    k_copy,
+    k_move,
     k_destruct
   };
 
-  using invoke_fn = R (*)(const rx_byte*, Ts&&...);
+  // Either the callable itself or a pointer to the allocated callable.
+  union storage {
+    rx_byte* as_pointer;
+    alignas(memory::allocator::k_alignment) rx_byte as_inline[k_inline_size];
+  };
+
+  template<typename F>
+  static constexpr const bool k_is_inline{sizeof(F) <= k_inline_size
+    && alignof(F) <= memory::allocator::k_alignment};
+
+  using invoke_fn = R (*)(const storage*, Ts&&...);
   using modify_lifetime_fn = void (*)(lifetime, rx_byte*, const rx_byte*);
 
   template<typename F>
-  static R invoke(const rx_byte* _function, Ts&&... _arguments) {
+  static const F* callable(const storage* _storage) {
+    if constexpr(k_is_inline<F>) {
+      return reinterpret_cast<const F*>(_storage->as_inline);
+    } else {
+      return reinterpret_cast<const F*>(_storage->as_pointer);
+    }
+  }
+
+  template<typename F>
+  static R invoke(const storage* _storage, Ts&&... _arguments) {
     if constexpr(traits::is_same<R, void>) {
-      (*reinterpret_cast<const F*>(_function))(utility::forward<Ts>(_arguments)...);
+      (*callable<F>(_storage))(utility::forward<Ts>(_arguments)...);
     } else {
-      return (*reinterpret_cast<const F*>(_function))(utility::forward<Ts>(_arguments)...);
+      return (*callable<F>(_storage))(utility::forward<Ts>(_arguments)...);
     }
   }
 
   template<typename F>
   static void modify_lifetime(lifetime _lifetime, rx_byte* _dst, const rx_byte* _src) {
     switch (_lifetime) {
-    case lifetime::k_construct:
+    case lifetime::k_copy:
       utility::construct<F>(_dst, *reinterpret_cast<const F*>(_src));
       break;
+    case lifetime::k_move:
+      utility::construct<F>(_dst, utility::move(*reinterpret_cast<F*>(const_cast<rx_byte*>(_src))));
+      break;
     case lifetime::k_destruct:
       utility::destruct<F>(_dst);
       break;
     }
   }
 
-  // Keep control block aligned so the function proceeding it in |m_data| is
-  // always aligned by |k_alignment| too.
-  struct alignas(memory::allocator::k_alignment) control_block {
-    constexpr control_block(modify_lifetime_fn _modify_lifetime, invoke_fn _invoke)
-      : modify_lifetime{_modify_lifetime}
-      , invoke{_invoke}
-    {
-    }
-    modify_lifetime_fn modify_lifetime;
+  // One immutable control block exists for every type of callable, it tells
+  // how to invoke, copy, move and destroy it.
+  struct control_block {
+    modify_lifetime_fn modify_lifetime; // nullptr when trivially copyable
     invoke_fn invoke;
+    rx_size size;
+    bool is_inline;
   };
 
-  void destroy();
+  template<typename F>
+  static constexpr const control_block k_control{
+    traits::is_trivially_copyable<F> ? nullptr : &modify_lifetime<F>,
+    &invoke<F>,
+    sizeof(F),
+    k_is_inline<F>
+  };
 
-  control_block* control();
-  const control_block* control() const;
+  // Copy or move the callable of |_function| into this empty function.
+  void assign(const function& _function, lifetime _lifetime);
+  void destroy();
 
-  rx_byte* storage();
-  const rx_byte* storage() const;
+  rx_byte* data();
+  const rx_byte* data() const;
 
   ref<memory::allocator> m_allocator;
-  rx_byte* m_data;
-  rx_size m_size;
+  const control_block* m_control;
+  storage m_storage;
 };
 
 template<typename R, typename... Ts>
 inline constexpr function<R(Ts...)>::function(memory::allocator& _allocator)
   : m_allocator{_allocator}
-  , m_data{nullptr}
-  , m_size{0}
+  , m_control{nullptr}
+  , m_storage{nullptr}
 {
 }
 
@@ -123,106 +182,73 @@ template<typename F, typename>
 inline function<R(Ts...)>::function(memory::allocator& _allocator, F&& _function)
   : function{_allocator}
 {
-  m_size = sizeof(control_block) + sizeof _function;
-  m_data = allocator().allocate(m_size);
-  RX_ASSERT(m_data, "out of memory");
+  using type = traits::remove_cvref<F>;
 
-  utility::construct<control_block>(m_data, &modify_lifetime<F>, &invoke<F>);
-  utility::construct<F>(storage(), utility::forward<F>(_function));
+  if constexpr(!k_is_inline<type>) {
+    m_storage.as_pointer = allocator().allocate(sizeof(type));
+    RX_ASSERT(m_storage.as_pointer, "out of memory");
+  }
+
+  m_control = &k_control<type>;
+  utility::construct<type>(data(), utility::forward<F>(_function));
 }
 
 template<typename R, typename... Ts>
 inline function<R(Ts...)>::function(const function& _function)
   : function{_function.allocator()}
 {
-  if (_function.m_data) {
-    m_size = _function.m_size;
-    m_data = allocator().allocate(m_size);
-    RX_ASSERT(m_data, "out of memory");
-
-    // Copy construct the control block and the function.
-    utility::construct<control_block>(m_data, *_function.control());
-    control()->modify_lifetime(lifetime::k_construct, storage(), _function.storage());
-  }
+  assign(_function, lifetime::k_copy);
 }
 
 template<typename R, typename... Ts>
 inline function<R(Ts...)>::function(function&& function_)
-  : m_allocator{function_.m_allocator}
-  , m_data{utility::exchange(function_.m_data, nullptr)}
-  , m_size{utility::exchange(function_.m_size, 0)}
+  : function{function_.allocator()}
 {
+  assign(function_, lifetime::k_move);
+  function_.destroy();
 }
 
 template<typename R, typename... Ts>
 inline function<R(Ts...)>& function<R(Ts...)>::operator=(const function& _function) {
   RX_ASSERT(&_function != this, "self assignment");
-
-  if (m_data) {
-    control()->modify_lifetime(lifetime::k_destruct, storage(), nullptr);
-  }
-
-  if (_function.m_data) {
-    // Reallocate storage to make function fit.
-    if (_function.m_size > m_size) {
-      m_size = _function.m_size;
-      m_data = allocator().reallocate(m_data, m_size);
-      RX_ASSERT(m_data, "out of memory");
-    }
-    // Copy construct the control block and the function.
-    utility::construct<control_block>(m_data, *_function.control());
-    control()->modify_lifetime(lifetime::k_construct, storage(), _function.storage());
-  } else {
-    destroy();
-  }
-
+  destroy();
+  assign(_function, lifetime::k_copy);
   return *this;
 }
 
 template<typename R, typename... Ts>
 inline function<R(Ts...)>& function<R(Ts...)>::operator=(function&& function_) {
   RX_ASSERT(&function_ != this, "self assignment");
-
-  if (m_data) {
-    control()->modify_lifetime(lifetime::k_destruct, storage(), nullptr);
-  }
-
+  destroy();
   m_allocator = function_.m_allocator;
-  m_size = utility::exchange(function_.m_size, 0);
-  m_data = utility::exchange(function_.m_data, nullptr);
-
+  assign(function_, lifetime::k_move);
+  function_.destroy();
   return *this;
 }
 
 template<typename R, typename... Ts>
 inline function<R(Ts...)>& function<R(Ts...)>::operator=(rx_nullptr) {
-  if (m_data) {
-    control()->modify_lifetime(lifetime::k_destruct, storage(), nullptr);
-    destroy();
-  }
+  destroy();
   return *this;
 }
 
 template<typename R, typename... Ts>
 inline function<R(Ts...)>::~function() {
-  if (m_data) {
-    control()->modify_lifetime(lifetime::k_destruct, storage(), nullptr);
-    destroy();
-  }
+  destroy();
 }
 
 template<typename R, typename... Ts>
 inline R function<R(Ts...)>::operator()(Ts... _arguments) const {
   if constexpr(traits::is_same<R, void>) {
-    control()->invoke(storage(), utility::forward<Ts>(_arguments)...);
+    m_control->invoke(&m_storage, utility::forward<Ts>(_arguments)...);
   } else {
-    return control()->invoke(storage(), utility::forward<Ts>(_arguments)...);
+    return m_control->invoke(&m_storage, utility::forward<Ts>(_arguments)...);
   }
 }
 
 template<typename R, typename... Ts>
 function<R(Ts...)>::operator bool() const {
-  return m_size != 0;
+  return m_control != nullptr;
 }
 
 template<typename R, typename... Ts>
@@ -231,30 +257,57 @@ RX_HINT_FORCE_INLINE constexpr memory::allocator& function<R(Ts...)>::allocator(
 }
 
 template<typename R, typename... Ts>
-inline void function<R(Ts...)>::destroy() {
-  allocator().deallocate(m_data);
-  m_data = nullptr;
-  m_size = 0;
-}
+inline void function<R(Ts...)>::assign(const function& _function, lifetime _lifetime) {
+  const control_block* control{_function.m_control};
+  if (!control) {
+    return;
+  }
 
-template<typename R, typename... Ts>
-RX_HINT_FORCE_INLINE typename function<R(Ts...)>::control_block* function<R(Ts...)>::control() {
-  return reinterpret_cast<control_block*>(m_data);
+  if (!control->is_inline) {
+    // An allocated callable moves with the pointer to it.
+    if (_lifetime == lifetime::k_move) {
+      m_storage.as_pointer = _function.m_storage.as_pointer;
+      m_control = control;
+      const_cast<function&>(_function).m_control = nullptr;
+      return;
+    }
+    m_storage.as_pointer = allocator().allocate(control->size);
+    RX_ASSERT(m_storage.as_pointer, "out of memory");
+  }
+
+  m_control = control;
+  if (control->modify_lifetime) {
+    control->modify_lifetime(_lifetime, data(), _function.data());
+  } else {
+    memcpy(data(), _function.data(), control->size);
+  }
 }
 
 template<typename R, typename... Ts>
-RX_HINT_FORCE_INLINE const typename function<R(Ts...)>::control_block* function<R(Ts...)>::control() const {
-  return reinterpret_cast<const control_block*>(m_data);
+inline void function<R(Ts...)>::destroy() {
+  if (!m_control) {
+    return;
+  }
+
+  if (m_control->modify_lifetime) {
+    m_control->modify_lifetime(lifetime::k_destruct, data(), nullptr);
+  }
+
+  if (!m_control->is_inline) {
+    allocator().deallocate(m_storage.as_pointer);
+  }
+
+  m_control = nullptr;
 }
 
 template<typename R, typename... Ts>
-RX_HINT_FORCE_INLINE rx_byte* function<R(Ts...)>::storage() {
-  return m_data + sizeof(control_block);
+RX_HINT_FORCE_INLINE rx_byte* function<R(Ts...)>::data() {
+  return m_control->is_inline ? m_storage.as_inline : m_storage.as_pointer;
 }
 
 template<typename R, typename... Ts>
-RX_HINT_FORCE_INLINE const rx_byte* function<R(Ts...)>::storage() const {
-  return m_data + sizeof(control_block);
+RX_HINT_FORCE_INLINE const rx_byte* function<R(Ts...)>::data() const {
+  return m_control->is_inline ? m_storage.as_inline : m_storage.as_pointer;
 }
 
 } // namespace rx::core
@@ -0,0 +1,87 @@
+#ifndef RX_CORE_FUNCTION_REF_H
+#define RX_CORE_FUNCTION_REF_H
+#include "rx/core/types.h"
+
+#include "rx/core/traits/is_callable.h"
+#include "rx/core/traits/is_function.h"
+#include "rx/core/traits/is_same.h"
+#include "rx/core/traits/remove_cvref.h"
+#include "rx/core/traits/remove_reference.h"
+#include "rx/core/traits/enable_if.h"
+
+#include "rx/core/utility/forward.h"
+
+#include "rx/core/hints/force_inline.h"
+
+namespace rx {
+
+// # Function Reference
+//
+// Non-owning reference to a callable, for parameters which are only called
+// before the function taking them returns. Unlike |function| it never
+// allocates nor copies the callable, it's a pointer to the callable and a
+// pointer to a function invoking it.
+//
+// The callable must outlive the reference. Constructing a reference from a
+// temporary lambda in the argument list of a call is fine, storing one is not.
+//
+// 32-bit: 8 bytes
+// 64-bit: 16 bytes
+template<typename T>
+struct function_ref;
+
+template<typename R, typename... Ts>
+struct function_ref<R(Ts...)> {
+  template<typename F, typename = traits::enable_if<traits::is_callable<traits::remove_reference<F>, Ts...>
+    && !traits::is_same<traits::remove_cvref<F>, function_ref>>>
+  function_ref(F&& _function);
+
+  constexpr function_ref(const function_ref& _function) = default;
+  constexpr function_ref& operator=(const function_ref& _function) = default;
+
+  R operator()(Ts... _arguments) const;
+
+private:
+  union callable {
+    const void* as_object;
+    void (*as_function)();
+  };
+
+  using invoke_fn = R (*)(callable, Ts&&...);
+
+  template<typename F>
+  static R invoke(callable _callable, Ts&&... _arguments) {
+    if constexpr(traits::is_function<F>) {
+      return reinterpret_cast<F*>(_callable.as_function)(utility::forward<Ts>(_arguments)...);
+    } else {
+      return (*static_cast<F*>(const_cast<void*>(_callable.as_object)))(utility::forward<Ts>(_arguments)...);
+    }
+  }
+
+  callable m_callable;
+  invoke_fn m_invoke;
+};
+
+template<typename R, typename... Ts>
+template<typename F, typename>
+inline function_ref<R(Ts...)>::function_ref(F&& _function)
+  : m_callable{}
+  , m_invoke{&invoke<traits::remove_reference<F>>}
+{
+  // Plain functions are referenced through a function pointer, every other
+  // callable through a pointer to the object.
+  if constexpr(traits::is_function<traits::remove_reference<F>>) {
+    m_callable.as_function = reinterpret_cast<void (*)()>(&_function);
+  } else {
+    m_callable.as_object = &_function;
+  }
+}
+
+template<typename R, typename... Ts>
+RX_HINT_FORCE_INLINE R function_ref<R(Ts...)>::operator()(Ts... _arguments) const {
+  return m_invoke(m_callable, utility::forward<Ts>(_arguments)...);
+}
+
+} // namespace rx
+
+#endif // RX_CORE_FUNCTION_REF_H
@@ -286,12 +286,30 @@ inline bool map<K, V>::erase(const K& _key) {
       utility::destruct<V>(m_values + index);
     }
 
-    if constexpr (sizeof index == 8) {
-      element_hash(index) |= 0x8000000000000000;
-    } else {
-      element_hash(index) |= 0x80000000;
+    // Shift the elements after it back by one until an empty slot or an element
+    // in its desired position, instead of leaving a tombstone. Tombstones are
+    // never reclaimed, under churn they take every empty slot and probing for a
+    // key no longer stops where it should.
+    for (;;) {
+      const rx_size next{(index + 1) & m_mask};
+      const rx_size hash{element_hash(next)};
+      if (hash == 0 || probe_distance(hash, next) == 0) {
+        break;
+      }
+
+      construct(index, hash, utility::move(m_keys[next]), utility::move(m_values[next]));
+      if constexpr (!traits::is_trivially_destructible<K>) {
+        utility::destruct<K>(m_keys + next);
+      }
+      if constexpr (!traits::is_trivially_destructible<V>) {
+        utility::destruct<V>(m_values + next);
+      }
+
+      index = next;
     }
 
+    element_hash(index) = 0;
+
     m_size--;
     return true;
   }
@@ -0,0 +1,184 @@
+#include <string.h> // memcpy
+
+#include "rx/core/memory/arena_allocator.h"
+#include "rx/core/concurrency/scope_lock.h"
+
+#include "rx/core/hints/likely.h"
+#include "rx/core/hints/unlikely.h"
+
+namespace rx::memory {
+
+// Each block of the arena is prefixed with this header.
+struct alignas(allocator::k_alignment) arena_allocator::block {
+  block* next;
+  rx_size size; // bytes after the header
+
+  rx_byte* begin() {
+    return reinterpret_cast<rx_byte*>(this + 1);
+  }
+
+  rx_byte* end() {
+    return begin() + size;
+  }
+};
+
+arena_allocator::arena_allocator(allocator& _allocator, rx_size _block_size)
+  : m_allocator{_allocator}
+  , m_block_size{round_to_alignment(_block_size)}
+  , m_head{nullptr}
+  , m_current{nullptr}
+  , m_this_point{nullptr}
+  , m_last_point{nullptr}
+  , m_reserved{0}
+{
+}
+
+arena_allocator::~arena_allocator() {
+  for (block* next{m_head}; next; ) {
+    block* current{next};
+    next = next->next;
+    m_allocator.deallocate(current);
+  }
+}
+
+rx_byte* arena_allocator::allocate(rx_size _size) {
+  concurrency::scope_lock locked{m_lock};
+  return allocate_unlocked(_size);
+}
+
+rx_byte* arena_allocator::allocate_unlocked(rx_size _size) {
+  // Round |_size| to a multiple of k_alignment to keep all pointers
+  // aligned by k_alignment.
+  _size = _size ? round_to_alignment(_size) : k_alignment;
+
+  if (RX_HINT_UNLIKELY(!m_current
+    || static_cast<rx_size>(m_current->end() - m_this_point) < _size))
+  {
+    if (RX_HINT_UNLIKELY(!next_block(_size))) {
+      return nullptr;
+    }
+  }
+
+  // Backup the last point to make deallocation and reallocation possible.
+  m_last_point = m_this_point;
+  m_this_point += _size;
+
+  return m_last_point;
+}
+
+rx_byte* arena_allocator::reallocate(void* _data, rx_size _size) {
+  if (RX_HINT_UNLIKELY(!_data)) {
+    return allocate(_size);
+  }
+
+  concurrency::scope_lock locked{m_lock};
+
+  const auto data{reinterpret_cast<rx_byte*>(_data)};
+  const rx_size size{_size ? round_to_alignment(_size) : k_alignment};
+
+  // Resize the most recent allocation in place when it fits in its block.
+  if (data == m_last_point
+    && static_cast<rx_size>(m_current->end() - m_last_point) >= size)
+  {
+    m_this_point = m_last_point + size;
+    return data;
+  }
+
+  // The size of the allocation isn't known, copy up to the end of what's used
+  // of the block holding it, past it is other allocations or unused space.
+  rx_size available{0};
+  for (block* owner{m_head}; owner; owner = owner->next) {
+    if (data >= owner->begin() && data < owner->end()) {
+      const rx_byte* end{owner == m_current ? m_this_point : owner->end()};
+      available = static_cast<rx_size>(end - data);
+      break;
+    }
+  }
+
+  rx_byte* resize{allocate_unlocked(_size)};
+  if (RX_HINT_LIKELY(resize)) {
+    // Never copy into the new allocation itself.
+    if (resize > data && static_cast<rx_size>(resize - data) < available) {
+      available = static_cast<rx_size>(resize - data);
+    }
+    memcpy(resize, data, available < size ? available : size);
+  }
+
+  return resize;
+}
+
+void arena_allocator::deallocate(void* _data) {
+  concurrency::scope_lock locked{m_lock};
+
+  // Can only deallocate provided |_data| is the address of |m_last_point|,
+  // i.e it's the most recently allocated or reallocated.
+  if (_data && _data == m_last_point) {
+    m_this_point = m_last_point;
+    m_last_point = nullptr;
+  }
+}
+
+arena_allocator::marker arena_allocator::mark() const {
+  concurrency::scope_lock locked{m_lock};
+  return {m_current, m_this_point};
+}
+
+void arena_allocator::rewind(const marker& _marker) {
+  concurrency::scope_lock locked{m_lock};
+  m_current = _marker.owner;
+  m_this_point = _marker.point;
+  m_last_point = nullptr;
+}
+
+void arena_allocator::trim() {
+  concurrency::scope_lock locked{m_lock};
+
+  block* next{m_current ? m_current->next : m_head};
+  if (m_current) {
+    m_current->next = nullptr;
+  } else {
+    m_head = nullptr;
+  }
+
+  while (next) {
+    block* current{next};
+    next = next->next;
+    m_reserved -= current->size;
+    m_allocator.deallocate(current);
+  }
+}
+
+rx_size arena_allocator::reserved() const {
+  concurrency::scope_lock locked{m_lock};
+  return m_reserved;
+}
+
+bool arena_allocator::next_block(rx_size _size) {
+  // Reuse the block after the current one when it's large enough, otherwise
+  // insert a new block before it so it's still reused later.
+  block* next{m_current ? m_current->next : m_head};
+  if (!next || next->size < _size) {
+    const rx_size size{_size > m_block_size ? _size : m_block_size};
+    auto insert{reinterpret_cast<block*>(m_allocator.allocate(sizeof(block) + size))};
+    if (RX_HINT_UNLIKELY(!insert)) {
+      return false;
+    }
+
+    insert->next = next;
+    insert->size = size;
+    if (m_current) {
+      m_current->next = insert;
+    } else {
+      m_head = insert;
+    }
+
+    m_reserved += size;
+    next = insert;
+  }
+
+  m_current = next;
+  m_this_point = next->begin();
+  return true;
+}
+
+} // namespace rx::memory
@@ -0,0 +1,125 @@
+#ifndef RX_CORE_MEMORY_ARENA_ALLOCATOR_H
+#define RX_CORE_MEMORY_ARENA_ALLOCATOR_H
+#include "rx/core/memory/allocator.h"
+#include "rx/core/concurrency/spin_lock.h"
+
+#include "rx/core/concepts/no_copy.h"
+#include "rx/core/concepts/no_move.h"
+
+#include "rx/core/hints/empty_bases.h"
+#include "rx/core/hints/force_inline.h"
+
+namespace rx::memory {
+
+// # Arena Allocator
+//
+// Growing bump point allocator, for temporaries which all go away at once.
+//
+// Allocations bump a pointer through a chain of blocks taken from |_allocator|
+// as the arena grows. Blocks are |_block_size| bytes, or larger when a single
+// allocation needs more.
+//
+// Individual allocations aren't freed, except the most recent one which can
+// also be resized in place like with a bump point allocator. Instead the arena
+// is rewound: |mark| records the current point and |rewind| frees everything
+// allocated after it in constant time, |reset| frees everything.
+//
+// Blocks stay with the arena when it's rewound and are reused by allocations
+// after it, so an arena reused for similar work stops taking memory from its
+// allocator. Only |trim| and the destructor return blocks.
+struct arena_allocator
+  final : allocator
+{
+  static constexpr const rx_size k_block_size{64 * 1024};
+
+  arena_allocator() = delete;
+  arena_allocator(allocator& _allocator, rx_size _block_size);
+  arena_allocator(allocator& _allocator);
+  ~arena_allocator();
+
+  virtual rx_byte* allocate(rx_size _size);
+  virtual rx_byte* reallocate(void* _data, rx_size _size);
+  virtual void deallocate(void* _data);
+
+  struct block;
+
+  // Opaque point in the arena to rewind to.
+  struct marker {
+    block* owner;
+    rx_byte* point;
+  };
+
+  struct scope;
+
+  marker mark() const;
+
+  // free everything allocated after |_marker| was made, markers made after it
+  // become invalid
+  void rewind(const marker& _marker);
+
+  // free everything
+  void reset();
+
+  // return the blocks after the current point to the allocator, markers after
+  // the current point become invalid
+  void trim();
+
+  // bytes in blocks held by the arena
+  rx_size reserved() const;
+
+  constexpr allocator& parent() const;
+
+private:
+  rx_byte* allocate_unlocked(rx_size _size);
+  bool next_block(rx_size _size);
+
+  allocator& m_allocator;
+  rx_size m_block_size;
+
+  mutable concurrency::spin_lock m_lock;
+  block* m_head;         // protected by |m_lock|
+  block* m_current;      // protected by |m_lock|
+  rx_byte* m_this_point; // protected by |m_lock|
+  rx_byte* m_last_point; // protected by |m_lock|
+  rx_size m_reserved;    // protected by |m_lock|
+};
+
+// Rewinds the arena to where it was when the scope was entered.
+struct RX_HINT_EMPTY_BASES arena_allocator::scope
+  : concepts::no_copy
+  , concepts::no_move
+{
+  scope(arena_allocator& _arena);
+  ~scope();
+
+private:
+  arena_allocator& m_arena;
+  marker m_marker;
+};
+
+inline arena_allocator::arena_allocator(allocator& _allocator)
+  : arena_allocator{_allocator, k_block_size}
+{
+}
+
+inline void arena_allocator::reset() {
+  rewind({nullptr, nullptr});
+}
+
+RX_HINT_FORCE_INLINE constexpr allocator& arena_allocator::parent() const {
+  return m_allocator;
+}
+
+inline arena_allocator::scope::scope(arena_allocator& _arena)
+  : m_arena{_arena}
+  , m_marker{_arena.mark()}
+{
+}
+
+inline arena_allocator::scope::~scope() {
+  m_arena.rewind(m_marker);
+}
+
+} // namespace rx::memory
+
+#endif // RX_CORE_MEMORY_ARENA_ALLOCATOR_H
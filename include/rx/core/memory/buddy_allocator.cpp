@@ -1,9 +1,11 @@
-#include <string.h> // memcpy
+#include <string.h> // memcpy, memset
 
 #include "rx/core/memory/buddy_allocator.h"
 
 #include "rx/core/concurrency/scope_lock.h"
 
+#include "rx/core/utility/bit.h"
+
 #include "rx/core/hints/unlikely.h"
 #include "rx/core/hints/likely.h"
 
@@ -11,164 +13,37 @@
 
 namespace rx::memory {
 
+static constexpr const rx_size k_min_shift{5};
+static_assert(buddy_allocator::k_min_size == 1_z << k_min_shift,
+  "k_min_shift doesn't match k_min_size");
+
 // Each allocation in the heap is prefixed with this header.
-struct alignas(allocator::k_alignment) block {
+struct alignas(allocator::k_alignment) header {
+  rx_size order;
   rx_size size;
-  bool free;
 };
 
-// Returns the next block in the intrusive, flat linked-list structure.
-static inline block* next(block* _block) {
-  return reinterpret_cast<block*>(reinterpret_cast<rx_byte*>(_block) + _block->size);
-}
-
-// Returns size that is needed for |_size|.
-static inline rx_size needed(rx_size _size) {
-  rx_size result = allocator::k_alignment; // Smallest allocation
-
-  // Storage for the block.
-  _size += sizeof(block);
-
-  // Continually double result until |_size| fits.
-  while (_size > result) {
-    result <<= 1;
-  }
-
-  return result;
-}
-
-// Continually divides the block |block_| until it's the optimal size for
-// an allocation of size |_size|.
-static block* divide(block* block_, rx_size _size) {
-  while (block_->size > _size) {
-    // Split block into two halves, half-size each.
-    const auto size = block_->size >> 1;
-    block_->size = size;
-
-    block_ = next(block_);
-    block_->size = size;
-    block_->free = true;
-  }
-
-  return block_->size >= _size ? block_ : nullptr;
-}
-
-// Searches for a free block that matches the given size |_size| in the list
-// defined by |_head| and |_tail|. When a block cannot be found which satisifies
-// the size |_size| but there is a larger free block, this divides the free
-// block into two halves of the same size until the block optimally fits the
-// size |_size| in it. If there is no larger free block available, this returns
-// nullptr.
-//
-// This function also merges adjacent free blocks as it searches to make larger,
-// free blocks available during the search.
-static block* find_available(block* _head, block* _tail, rx_size _size) {
-  block* region = _head;
-  block* buddy = next(region);
-  block* closest = nullptr;
-
-  // When at the end of the heap and the region is free.
-  if (buddy == _tail && region->free) {
-    // Split it into a block to satisfy the request leaving what is left over
-    // for any future allocations. This is the one edge case the general
-    // algorithm cannot cover.
-    return divide(region, _size);
-  }
-
-  // Find the closest minimum sized match within the heap.
-  rx_size closest_size = 0;
-  while (region < _tail && buddy < _tail) {
-    // When both the region and the buddy are free, merge those adjacent
-    // free blocks.
-    if (region->free && buddy->free && region->size == buddy->size) {
-      region->size <<= 1;
-
-      const rx_size region_size = region->size;
-      if (_size <= region_size && (!closest || region_size <= closest->size)) {
-        closest = region;
-      }
-
-      if ((region = next(buddy)) < _tail) {
-        buddy = next(region);
-      }
-    } else {
-      if (closest) {
-        closest_size = closest->size;
-      }
-
-      // Check the region block.
-      const rx_size region_size = region->size;
-      if (region->free && _size <= region_size
-        && (!closest || region_size <= closest->size))
-      {
-        closest = region;
-        closest_size = region_size;
-      }
-
-      // Check the buddy block.
-      const rx_size buddy_size = buddy->size;
-      if (buddy->free && _size <= buddy_size
-        && (!closest || buddy_size <= closest->size))
-      {
-        closest = buddy;
-        closest_size = buddy_size;
-      }
+static_assert(sizeof(header) == allocator::k_alignment,
+  "header must not be larger than k_alignment");
 
-      // The buddy has been split up into smaller blocks.
-      if (region_size > buddy_size) {
-        region = buddy;
-        buddy = next(buddy);
-      } else if ((region = next(buddy)) < _tail) {
-        // Skip the base and buddy region for the next iteration.
-        buddy = next(region);
-      }
-    }
-  }
-
-  if (closest) {
-    // Perfect match.
-    if (closest_size == _size) {
-      return closest;
-    }
-
-    // Split |current| in halves continually until it optimally fits |_size|.
-    return divide(closest, _size);
-  }
-
-  // Potentially out of memory.
-  return nullptr;
-}
-
-// Performs a single level merge of adjacent free blocks in the list given
-// by |_head| and |_tail|.
-static bool merge_free(block* _head, block* _tail) {
-  block* region = _head;
-  block* buddy = next(region);
-
-  bool modified = false;
-  while (region < _tail && buddy < _tail) {
-    // Both the region and buddy are free.
-    if (region->free && buddy->free && region->size == buddy->size) {
-      // Merge the blocks back into one, larger one.
-      region->size <<= 1;
-      if ((region = next(region)) < _tail) {
-        buddy = next(region);
-      }
-      modified = true;
-    } else if (region->size > buddy->size) {
-      // The buddy block has been split into smaller blocks.
-      region = buddy;
-      buddy = next(buddy);
-    } else if ((region = next(buddy)) < _tail) {
-      // Skip the base and buddy region for the next iteration.
-      buddy = next(region);
-    }
-  }
-
-  return modified;
-}
+// Free blocks are linked through their first bytes.
+struct buddy_allocator::block {
+  block* next;
+  block* prev;
+};
 
-buddy_allocator::buddy_allocator(rx_byte* _data, rx_size _size) {
+static_assert(sizeof(void*) * 2 <= buddy_allocator::k_min_size,
+  "k_min_size too small for a free block");
+
+buddy_allocator::buddy_allocator(rx_byte* _data, rx_size _size)
+  : m_data{_data}
+  , m_size{_size}
+  , m_max_order{bit_search_msb(static_cast<rx_u64>(_size)) - k_min_shift}
+  , m_pairs{reinterpret_cast<rx_u64*>(_data)}
+  , m_free_lists{}
+  , m_free_orders{0}
+  , m_statistics{}
+{
   // Ensure |_data| and |_size| are multiples of |k_alignment|.
   RX_ASSERT(reinterpret_cast<rx_uintptr>(_data) % k_alignment == 0,
     "_data not a multiple of k_alignment");
@@ -178,14 +53,23 @@ buddy_allocator::buddy_allocator(rx_byte* _data, rx_size _size) {
   // Ensure |_size| is a power of two.
   RX_ASSERT((_size & (_size - 1)) == 0, "_size not a power of two");
 
-  // Create the root block structure.
-  block* head = reinterpret_cast<block*>(_data);
+  // The bitmap takes the first blocks of the region, which are never freed.
+  const rx_size blocks{_size >> k_min_shift};
+  rx_size metadata{(blocks + 63) / 64 * sizeof(rx_u64)};
+  metadata = (metadata + k_min_size - 1) & ~(k_min_size - 1);
+  RX_ASSERT(metadata < _size, "_size too small");
+
+  memset(m_pairs, 0, metadata);
 
-  head->size = _size;
-  head->free = true;
+  // Cover the rest of the region with the largest blocks its alignment allows.
+  for (rx_size offset{metadata}; offset < _size; ) {
+    const rx_size order{bit_search_lsb(static_cast<rx_u64>(offset)) - k_min_shift};
+    toggle(order, offset);
+    link(order, offset);
+    offset += k_min_size << order;
+  }
 
-  m_head = reinterpret_cast<void*>(head);
-  m_tail = reinterpret_cast<void*>(next(head));
+  m_statistics.total_bytes = _size - metadata;
 }
 
 rx_byte* buddy_allocator::allocate(rx_size _size) {
@@ -203,76 +87,210 @@ void buddy_allocator::deallocate(void* _data) {
   deallocate_unlocked(_data);
 }
 
-rx_byte* buddy_allocator::allocate_unlocked(rx_size _size) {
-  const auto size = needed(_size);
-
-  const auto head = reinterpret_cast<block*>(m_head);
-  const auto tail = reinterpret_cast<block*>(m_tail);
+buddy_allocator::statistics buddy_allocator::stats() const {
+  concurrency::scope_lock lock{m_lock};
+  statistics result{m_statistics};
+  result.largest_free_block = m_free_orders
+    ? k_min_size << bit_search_msb(m_free_orders) : 0;
+  return result;
+}
 
-  auto find = find_available(head, tail, size);
+rx_byte* buddy_allocator::allocate_unlocked(rx_size _size) {
+  const rx_size order{order_of(_size)};
+  if (RX_HINT_UNLIKELY(order > m_max_order)) {
+    return nullptr;
+  }
 
-  if (RX_HINT_LIKELY(find)) {
-    find->free = false;
-    return reinterpret_cast<rx_byte*>(find + 1);
+  // Find the smallest order with a free block large enough.
+  const rx_u64 orders{m_free_orders & ~((1_u64 << order) - 1)};
+  if (RX_HINT_UNLIKELY(!orders)) {
+    // Out of memory.
+    return nullptr;
   }
 
-  // Merge free blocks until they're all merged.
-  while (merge_free(head, tail)) {
-    ;
+  rx_size current{bit_search_lsb(orders)};
+  const rx_size offset{static_cast<rx_size>(reinterpret_cast<rx_byte*>(m_free_lists[current]) - m_data)};
+  unlink(current, offset);
+  if (current < m_max_order) {
+    toggle(current, offset);
   }
 
-  // Search again for a free block.
-  if ((find = find_available(head, tail, size))) {
-    find->free = false;
-    return reinterpret_cast<rx_byte*>(find + 1);
+  // Split it in halves until it fits, freeing the upper halves.
+  while (current > order) {
+    current--;
+    const rx_size buddy{offset + (k_min_size << current)};
+    toggle(current, buddy);
+    link(current, buddy);
   }
 
-  // Out of memory.
-  return nullptr;
+  const auto region{reinterpret_cast<header*>(m_data + offset)};
+  region->order = order;
+  region->size = _size;
+
+  m_statistics.used_bytes += k_min_size << order;
+  m_statistics.request_bytes += _size;
+  m_statistics.allocations++;
+
+  return reinterpret_cast<rx_byte*>(region + 1);
 }
 
 rx_byte* buddy_allocator::reallocate_unlocked(void* _data, rx_size _size) {
-  if (RX_HINT_LIKELY(_data)) {
-    const auto region = reinterpret_cast<block*>(_data) - 1;
+  if (RX_HINT_UNLIKELY(!_data)) {
+    return allocate_unlocked(_size);
+  }
 
-    const auto head = reinterpret_cast<block*>(m_head);
-    const auto tail = reinterpret_cast<block*>(m_tail);
+  const auto region{reinterpret_cast<header*>(_data) - 1};
+  RX_ASSERT(reinterpret_cast<rx_byte*>(region) >= m_data, "out of heap");
+  RX_ASSERT(reinterpret_cast<rx_byte*>(region) < m_data + m_size, "out of heap");
 
-    RX_ASSERT(region >= head, "out of heap");
-    RX_ASSERT(region <= tail - 1, "out of heap");
+  const rx_size offset{static_cast<rx_size>(reinterpret_cast<rx_byte*>(region) - m_data)};
+  const rx_size order{order_of(_size)};
+  if (RX_HINT_UNLIKELY(order > m_max_order)) {
+    return nullptr;
+  }
 
-    // No need to resize.
-    if (region->size >= needed(_size)) {
-      return reinterpret_cast<rx_byte*>(_data);
+  rx_size current{region->order};
+  if (order <= current) {
+    // Shrink in place, freeing the upper halves. The lower half stays
+    // allocated so none of them can merge.
+    while (current > order) {
+      current--;
+      const rx_size buddy{offset + (k_min_size << current)};
+      toggle(current, buddy);
+      link(current, buddy);
+    }
+  } else {
+    // Grow in place when the block is the lower half of every buddy pair up to
+    // the order and every buddy is free. The block isn't free, so the bit of a
+    // pair is set exactly when its buddy is.
+    bool grows{true};
+    for (rx_size i{current}; i < order; i++) {
+      if ((offset & (k_min_size << i)) || !test(i, offset)) {
+        grows = false;
+        break;
+      }
     }
 
-    // Create a new allocation.
-    auto resize = allocate_unlocked(_size);
-    if (RX_HINT_LIKELY(resize)) {
-      memcpy(resize, _data, region->size - sizeof *region);
-      deallocate_unlocked(_data);
-      return resize;
+    if (!grows) {
+      auto resize{allocate_unlocked(_size)};
+      if (RX_HINT_LIKELY(resize)) {
+        memcpy(resize, _data, region->size < _size ? region->size : _size);
+        deallocate_unlocked(_data);
+        return resize;
+      }
+
+      // Out of memory.
+      return nullptr;
     }
 
-    // Out of memory.
-    return nullptr;
+    for (; current < order; current++) {
+      toggle(current, offset);
+      unlink(current, offset + (k_min_size << current));
+    }
   }
 
-  return allocate_unlocked(_size);
+  m_statistics.used_bytes -= k_min_size << region->order;
+  m_statistics.used_bytes += k_min_size << order;
+  m_statistics.request_bytes -= region->size;
+  m_statistics.request_bytes += _size;
+
+  region->order = order;
+  region->size = _size;
+
+  return reinterpret_cast<rx_byte*>(_data);
 }
 
 void buddy_allocator::deallocate_unlocked(void* _data) {
   if (RX_HINT_LIKELY(_data)) {
-    const auto region = reinterpret_cast<block*>(_data) - 1;
+    const auto region{reinterpret_cast<header*>(_data) - 1};
+    RX_ASSERT(reinterpret_cast<rx_byte*>(region) >= m_data, "out of heap");
+    RX_ASSERT(reinterpret_cast<rx_byte*>(region) < m_data + m_size, "out of heap");
+
+    m_statistics.used_bytes -= k_min_size << region->order;
+    m_statistics.request_bytes -= region->size;
+    m_statistics.allocations--;
+
+    release(static_cast<rx_size>(reinterpret_cast<rx_byte*>(region) - m_data),
+      region->order);
+  }
+}
 
-    const auto head = reinterpret_cast<block*>(m_head);
-    const auto tail = reinterpret_cast<block*>(m_tail);
+rx_size buddy_allocator::order_of(rx_size _size) const {
+  if (RX_HINT_UNLIKELY(_size > m_size)) {
+    return k_orders;
+  }
+
+  // Storage for the header.
+  const rx_size size{_size + sizeof(header)};
+  if (size <= k_min_size) {
+    return 0;
+  }
+
+  return bit_search_msb(static_cast<rx_u64>(size - 1)) + 1 - k_min_shift;
+}
+
+rx_size buddy_allocator::pair_of(rx_size _order, rx_size _offset) const {
+  // The pairs of every order are laid out one order after another, there are
+  // half as many pairs in every next order.
+  const rx_size blocks{m_size >> k_min_shift};
+  return blocks - (blocks >> _order) + (_offset >> (k_min_shift + _order + 1));
+}
+
+bool buddy_allocator::test(rx_size _order, rx_size _offset) const {
+  const rx_size bit{pair_of(_order, _offset)};
+  return m_pairs[bit / 64] & (1_u64 << (bit % 64));
+}
+
+bool buddy_allocator::toggle(rx_size _order, rx_size _offset) {
+  const rx_size bit{pair_of(_order, _offset)};
+  return (m_pairs[bit / 64] ^= 1_u64 << (bit % 64)) & (1_u64 << (bit % 64));
+}
+
+void buddy_allocator::link(rx_size _order, rx_size _offset) {
+  auto node{reinterpret_cast<block*>(m_data + _offset)};
+  auto& head{m_free_lists[_order]};
 
-    RX_ASSERT(region >= head, "out of heap");
-    RX_ASSERT(region <= tail - 1, "out of heap");
+  node->prev = nullptr;
+  node->next = head;
+  if (head) {
+    head->prev = node;
+  }
+  head = node;
+
+  m_free_orders |= 1_u64 << _order;
+  m_statistics.free_blocks++;
+}
+
+void buddy_allocator::unlink(rx_size _order, rx_size _offset) {
+  auto node{reinterpret_cast<block*>(m_data + _offset)};
+  auto& head{m_free_lists[_order]};
+
+  if (node->prev) {
+    node->prev->next = node->next;
+  } else {
+    head = node->next;
+  }
 
-    region->free = true;
+  if (node->next) {
+    node->next->prev = node->prev;
   }
+
+  if (!head) {
+    m_free_orders &= ~(1_u64 << _order);
+  }
+  m_statistics.free_blocks--;
+}
+
+void buddy_allocator::release(rx_size _offset, rx_size _order) {
+  // Freeing the block clears the bit of its pair when the buddy is free too,
+  // then both merge into a free block of the next order.
+  while (_order < m_max_order && !toggle(_order, _offset)) {
+    unlink(_order, _offset ^ (k_min_size << _order));
+    _offset &= ~(k_min_size << _order);
+    _order++;
+  }
+
+  link(_order, _offset);
 }
 
 } // namespace rx::memory
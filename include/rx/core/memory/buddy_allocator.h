@@ -5,26 +5,99 @@
 
 namespace rx::memory {
 
+// # Buddy Allocator
+//
+// Allocator over a fixed region of memory of a power of two size. Every block
+// is a power of two multiple of |k_min_size| bytes, aligned on its own size,
+// and is split in two halves, a pair of buddies, to make smaller blocks.
+//
+// Free blocks are kept in a free list for every order of block size, with a
+// mask of the orders which have free blocks. Allocation takes the smallest
+// free block large enough and splits it down to the needed order, putting the
+// unused halves on their free lists. Freeing a block merges it with its buddy,
+// found by flipping the bit of its size in its offset, as long as the buddy is
+// free as a whole. Both take O(log n) time in the size of the region.
+//
+// Whether a buddy is free is tracked in a bitmap holding one bit per pair of
+// buddies of every order, set when exactly one of the pair is a free block.
+// The bitmap lives at the start of the region, taking one bit for every
+// |k_min_size| bytes of it.
+//
+// Every allocation is prefixed with a header of |k_alignment| bytes recording
+// the order of its block. A reallocation resizes in place when the block
+// shrinks, or grows when the buddies it grows into are free.
 struct buddy_allocator
   final : allocator
 {
+  static constexpr const rx_size k_min_size{k_alignment * 2};
+
   buddy_allocator(rx_byte* _data, rx_size _size);
 
   virtual rx_byte* allocate(rx_size _size);
   virtual rx_byte* reallocate(void* _data, rx_size _size);
   virtual void deallocate(void* _data);
 
+  struct statistics {
+    rx_size total_bytes;        // Bytes of the region available to allocations
+    rx_size used_bytes;         // Bytes in allocated blocks, headers and rounding included
+    rx_size request_bytes;      // Bytes requested by live allocations
+    rx_size allocations;        // Number of live allocations
+    rx_size free_blocks;        // Number of free blocks
+    rx_size largest_free_block; // Size of the largest free block in bytes
+
+    // Share of the used bytes lost to headers and rounding to block sizes.
+    rx_f32 internal_fragmentation() const;
+
+    // Share of the free bytes outside of the largest free block, which no
+    // single allocation can use.
+    rx_f32 external_fragmentation() const;
+  };
+
+  statistics stats() const;
+
 private:
+  struct block;
+
   rx_byte* allocate_unlocked(rx_size _size);
   rx_byte* reallocate_unlocked(void* _data, rx_size _size);
   void deallocate_unlocked(void* _data);
 
-  concurrency::spin_lock m_lock;
+  rx_size order_of(rx_size _size) const;
+
+  // Bit in |m_pairs| of the pair holding the block at |_offset| of |_order|.
+  rx_size pair_of(rx_size _order, rx_size _offset) const;
+  bool test(rx_size _order, rx_size _offset) const;
+  bool toggle(rx_size _order, rx_size _offset);
 
-  void* m_head; // protected by |m_lock|
-  void* m_tail; // protected by |m_lock|
+  void link(rx_size _order, rx_size _offset);
+  void unlink(rx_size _order, rx_size _offset);
+
+  // Free the block at |_offset| of |_order|, merging it with its buddies.
+  void release(rx_size _offset, rx_size _order);
+
+  static constexpr const rx_size k_orders{sizeof(rx_u64) * 8};
+
+  mutable concurrency::spin_lock m_lock;
+
+  rx_byte* m_data;
+  rx_size m_size;
+  rx_size m_max_order;
+
+  rx_u64* m_pairs;               // protected by |m_lock|
+  block* m_free_lists[k_orders]; // protected by |m_lock|
+  rx_u64 m_free_orders;          // protected by |m_lock|
+  statistics m_statistics;       // protected by |m_lock|
 };
 
+inline rx_f32 buddy_allocator::statistics::internal_fragmentation() const {
+  return used_bytes ? 1.0f - static_cast<rx_f32>(request_bytes) / used_bytes : 0.0f;
+}
+
+inline rx_f32 buddy_allocator::statistics::external_fragmentation() const {
+  const rx_size free_bytes{total_bytes - used_bytes};
+  return free_bytes ? 1.0f - static_cast<rx_f32>(largest_free_block) / free_bytes : 0.0f;
+}
+
 } // namespace rx::memory
 
 #endif // RX_CORE_MEMORY_BUDDY_ALLOCATOR_H
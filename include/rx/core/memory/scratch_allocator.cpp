@@ -0,0 +1,158 @@
+#include <string.h> // memcpy, memset
+
+#include "rx/core/memory/scratch_allocator.h"
+#include "rx/core/memory/system_allocator.h"
+
+#include "rx/core/hints/likely.h"
+#include "rx/core/hints/unlikely.h"
+
+namespace rx::memory {
+
+static constexpr const rx_size k_page_size{4096};
+
+#if defined(RX_DEBUG)
+// In debug builds each allocation is prefixed with this header.
+struct alignas(allocator::k_alignment) header {
+  rx_u64 frame;
+  rx_size size;
+};
+
+// Memory is alive in the frame it was allocated in and the next one. Headers
+// of memory from older frames were filled with garbage or overwritten by newer
+// allocations.
+static bool is_alive(const header* _header, rx_u64 _frame) {
+  return _header->frame == _frame || _header->frame + 1 == _frame;
+}
+
+static constexpr const rx_size k_header_size{sizeof(header)};
+#else
+static constexpr const rx_size k_header_size{0};
+#endif
+
+scratch_allocator::scratch_allocator(rx_size _frame_size)
+  : m_buffers{}
+  , m_buffer{m_buffers}
+  , m_overflows{0}
+  , m_frame{0}
+{
+  const rx_size pages{(_frame_size + k_page_size - 1) / k_page_size};
+  if (!m_memory.allocate(k_page_size, pages * 2)
+    || !m_memory.commit({0, pages * 2}, true, true))
+  {
+    // Every allocation falls back to the system allocator.
+    return;
+  }
+
+  for (rx_size i{0}; i < 2; i++) {
+    auto& buffer{m_buffers[i]};
+    buffer.begin = m_memory.page(pages * i);
+    buffer.end = buffer.begin + pages * k_page_size;
+    buffer.this_point = buffer.begin;
+    buffer.last_point = nullptr;
+  }
+}
+
+rx_byte* scratch_allocator::allocate(rx_size _size) {
+  // Round |_size| to a multiple of k_alignment to keep all pointers
+  // aligned by k_alignment. Empty allocations take k_alignment bytes too so
+  // they don't share the address of the next allocation.
+  _size = _size ? _size : k_alignment;
+  const rx_size size{round_to_alignment(_size) + k_header_size};
+
+  auto& buffer{*m_buffer};
+  if (RX_HINT_UNLIKELY(static_cast<rx_size>(buffer.end - buffer.this_point) < size)) {
+    m_overflows++;
+    return system_allocator::instance().allocate(_size);
+  }
+
+  buffer.last_point = buffer.this_point;
+  buffer.this_point += size;
+
+#if defined(RX_DEBUG)
+  auto record{reinterpret_cast<header*>(buffer.last_point)};
+  record->frame = frame();
+  record->size = _size;
+#endif
+
+  return buffer.last_point + k_header_size;
+}
+
+rx_byte* scratch_allocator::reallocate(void* _data, rx_size _size) {
+  if (RX_HINT_UNLIKELY(!_data)) {
+    return allocate(_size);
+  }
+
+  if (!owns(_data)) {
+    return system_allocator::instance().reallocate(_data, _size);
+  }
+
+  const auto data{reinterpret_cast<rx_byte*>(_data)};
+
+#if defined(RX_DEBUG)
+  auto record{reinterpret_cast<header*>(data - k_header_size)};
+  RX_ASSERT(is_alive(record, frame()), "reallocated after its frame ended");
+  const rx_size size{record->size};
+#endif
+
+  // Resize the most recent allocation in place when it fits.
+  auto& buffer{*m_buffer};
+  if (data - k_header_size == buffer.last_point) {
+    const rx_size rounded{(_size ? round_to_alignment(_size) : k_alignment) + k_header_size};
+    if (static_cast<rx_size>(buffer.end - buffer.last_point) >= rounded) {
+      buffer.this_point = buffer.last_point + rounded;
+#if defined(RX_DEBUG)
+      record->size = _size;
+#endif
+      return data;
+    }
+  }
+
+#if !defined(RX_DEBUG)
+  // The size of the allocation isn't known, copy up to the end of what's used
+  // of the buffer holding it, past it is other allocations or unused space.
+  // The buffer of the previous frame keeps the point it ended at, allocations
+  // only go past the point of the current buffer so nothing copied overlaps.
+  const auto& owner{data < m_buffers[1].begin ? m_buffers[0] : m_buffers[1]};
+  const rx_size size{static_cast<rx_size>(owner.this_point - data)};
+#endif
+
+  rx_byte* resize{allocate(_size)};
+  if (RX_HINT_LIKELY(resize)) {
+    memcpy(resize, data, size < _size ? size : _size);
+  }
+
+  return resize;
+}
+
+void scratch_allocator::deallocate(void* _data) {
+  if (!owns(_data)) {
+    system_allocator::instance().deallocate(_data);
+    return;
+  }
+
+  // Memory of a frame is only reclaimed by the frame after the next one.
+#if defined(RX_DEBUG)
+  auto record{reinterpret_cast<header*>(reinterpret_cast<rx_byte*>(_data) - k_header_size)};
+  RX_ASSERT(is_alive(record, frame()), "deallocated after its frame ended");
+#endif
+}
+
+void scratch_allocator::next_frame() {
+  m_frame.fetch_add(1, concurrency::memory_order::k_relaxed);
+  m_buffer = m_buffer == m_buffers ? m_buffers + 1 : m_buffers;
+  m_overflows = 0;
+
+  auto& buffer{*m_buffer};
+#if defined(RX_DEBUG)
+  memset(buffer.begin, 0xcd, buffer.this_point - buffer.begin);
+#endif
+  buffer.this_point = buffer.begin;
+  buffer.last_point = nullptr;
+}
+
+scratch_allocator& scratch_allocator::instance() {
+  static thread_local scratch_allocator s_instance;
+  return s_instance;
+}
+
+} // namespace rx::memory
@@ -0,0 +1,101 @@
+#ifndef RX_CORE_MEMORY_SCRATCH_ALLOCATOR_H
+#define RX_CORE_MEMORY_SCRATCH_ALLOCATOR_H
+#include "rx/core/memory/allocator.h"
+#include "rx/core/memory/vma.h"
+
+#include "rx/core/concurrency/atomic.h"
+
+#include "rx/core/hints/force_inline.h"
+
+namespace rx::memory {
+
+// # Scratch Allocator
+//
+// Double buffered frame allocator for short-lived temporaries, like strings
+// and vectors made while formatting or building paths in a loop.
+//
+// Every thread has its own scratch allocator, reached with |instance|. The
+// caller decides where a frame ends by calling |next_frame|. Memory allocated
+// in a frame stays valid through the next frame, and is reused by the frame
+// after it, so the results of one frame can still be read while the next is
+// being built.
+//
+// Each frame allocates by bumping a pointer through a buffer of |_frame_size|
+// bytes, deallocating does nothing. The most recent allocation is resized in
+// place. Allocations which don't fit the buffer of the frame fall back to the
+// system allocator, and must be deallocated like any other.
+//
+// Only the thread owning a scratch allocator may allocate from it, memory from
+// it can be deallocated on any thread.
+//
+// Debug builds prefix every allocation with the frame it was made in and
+// assert when memory is reallocated or deallocated after its frame ended, and
+// fill the buffer of a frame with garbage when it's reused so that reading
+// memory which escaped its frame is noticed.
+struct scratch_allocator
+  final : allocator
+{
+  static constexpr const rx_size k_frame_size{256 * 1024};
+
+  scratch_allocator(rx_size _frame_size);
+  scratch_allocator();
+
+  virtual rx_byte* allocate(rx_size _size);
+  virtual rx_byte* reallocate(void* _data, rx_size _size);
+  virtual void deallocate(void* _data);
+
+  // end the current frame, the memory of the frame before it is reused
+  void next_frame();
+
+  rx_u64 frame() const;
+
+  // bytes used by the current frame and allocations it made with the system
+  // allocator because they didn't fit
+  rx_size used() const;
+  rx_size overflows() const;
+
+  // scratch allocator of the calling thread
+  static scratch_allocator& instance();
+
+private:
+  struct buffer {
+    rx_byte* begin;
+    rx_byte* end;
+    rx_byte* this_point;
+    rx_byte* last_point;
+  };
+
+  bool owns(const void* _data) const;
+
+  vma m_memory;
+  buffer m_buffers[2];
+  buffer* m_buffer;
+  rx_size m_overflows;
+  concurrency::atomic<rx_u64> m_frame;
+};
+
+inline scratch_allocator::scratch_allocator()
+  : scratch_allocator{k_frame_size}
+{
+}
+
+RX_HINT_FORCE_INLINE rx_u64 scratch_allocator::frame() const {
+  return m_frame.load(concurrency::memory_order::k_relaxed);
+}
+
+RX_HINT_FORCE_INLINE rx_size scratch_allocator::used() const {
+  return m_buffer->this_point - m_buffer->begin;
+}
+
+RX_HINT_FORCE_INLINE rx_size scratch_allocator::overflows() const {
+  return m_overflows;
+}
+
+RX_HINT_FORCE_INLINE bool scratch_allocator::owns(const void* _data) const {
+  const auto data{reinterpret_cast<const rx_byte*>(_data)};
+  return data >= m_buffers[0].begin && data < m_buffers[1].end;
+}
+
+} // namespace rx::memory
+
+#endif // RX_CORE_MEMORY_SCRATCH_ALLOCATOR_H
@@ -1,17 +1,42 @@
 #include "rx/core/memory/stats_allocator.h"
-#include "rx/core/concurrency/scope_lock.h"
-#include "rx/core/algorithm/max.h"
 #include "rx/core/hints/unlikely.h"
+#include "rx/core/hints/force_inline.h"
 #include "rx/core/assert.h"
 
 namespace rx::memory {
 
+using concurrency::memory_order;
+
+// Threads are assigned shards in the order they first allocate.
+static concurrency::atomic<rx_size> g_next_shard{0};
+static thread_local const rx_size t_shard{
+  g_next_shard.fetch_add(1, memory_order::k_relaxed) % stats_allocator::k_shards};
+
+static void raise(concurrency::atomic<rx_u64>& peak_, rx_u64 _value) {
+  rx_u64 peak{peak_.load(memory_order::k_relaxed)};
+  while (peak < _value && !peak_.compare_exchange_weak(peak, _value,
+    memory_order::k_relaxed, memory_order::k_relaxed))
+  {
+    // { empty }
+  }
+}
+
 struct header {
   // requested allocation size, the actual size is round_to_alignment(size) + sizeof(header) + k_alignment
   rx_size size;
   rx_byte* base;
 };
 
+RX_HINT_FORCE_INLINE const stats_allocator::shard& stats_allocator::shard_at(rx_size _index) const {
+  const auto address{reinterpret_cast<rx_uintptr>(m_shard_storage)};
+  const auto aligned{(address + concurrency::k_cache_line - 1) & ~(concurrency::k_cache_line - 1)};
+  return reinterpret_cast<const padded_shard*>(aligned)[_index].as_shard;
+}
+
+RX_HINT_FORCE_INLINE stats_allocator::shard& stats_allocator::local_shard() {
+  return const_cast<shard&>(shard_at(t_shard));
+}
+
 rx_byte* stats_allocator::allocate(rx_size _size) {
   const rx_uintptr size_as_multiple{round_to_alignment(_size)};
   const rx_uintptr actual_size{size_as_multiple + sizeof(header) + k_alignment};
@@ -27,14 +52,10 @@ rx_byte* stats_allocator::allocate(rx_size _size) {
   node->size = _size;
   node->base = base;
 
-  {
-    concurrency::scope_lock locked{m_lock};
-    m_statistics.allocations++;
-    m_statistics.used_request_bytes += _size;
-    m_statistics.used_actual_bytes += actual_size;
-    m_statistics.peak_request_bytes = algorithm::max(m_statistics.peak_request_bytes, m_statistics.used_request_bytes);
-    m_statistics.peak_actual_bytes = algorithm::max(m_statistics.peak_actual_bytes, m_statistics.used_actual_bytes);
-  }
+  auto& shard{local_shard()};
+  shard.allocations.fetch_add(1, memory_order::k_relaxed);
+  add(shard, _size, actual_size);
+
   return aligned;
 }
 
@@ -67,17 +88,13 @@ rx_byte* stats_allocator::reallocate(void* _data, rx_size _size) {
   node->size = _size;
   node->base = resize;
 
-  {
-    concurrency::scope_lock locked{m_lock};
-    m_statistics.request_reallocations++;
-    if (resize == original) {
-      m_statistics.actual_reallocations++;
-    }
-    m_statistics.used_request_bytes -= original_request_size;
-    m_statistics.used_actual_bytes -= original_actual_size;
-    m_statistics.used_request_bytes += _size;
-    m_statistics.used_actual_bytes += actual_size;
+  auto& shard{local_shard()};
+  shard.request_reallocations.fetch_add(1, memory_order::k_relaxed);
+  if (resize == original) {
+    shard.actual_reallocations.fetch_add(1, memory_order::k_relaxed);
   }
+  add(shard, _size - original_request_size, actual_size - original_actual_size);
+
   return aligned;
 }
 
@@ -91,20 +108,73 @@ void stats_allocator::deallocate(void* _data) {
   const rx_size actual_size
     = round_to_alignment(node->size) + sizeof(header) + k_alignment;
 
-  {
-    concurrency::scope_lock locked{m_lock};
-    m_statistics.deallocations++;
-    m_statistics.used_request_bytes -= request_size;
-    m_statistics.used_actual_bytes -= actual_size;
-  }
+  auto& shard{local_shard()};
+  shard.deallocations.fetch_add(1, memory_order::k_relaxed);
+  add(shard, -request_size, -actual_size);
 
   m_allocator.deallocate(node);
 }
 
 stats_allocator::statistics stats_allocator::stats() const {
-  // Hold a lock and make an entire copy of the structure atomically
-  concurrency::scope_lock locked{m_lock};
-  return m_statistics;
+  statistics result{};
+  rx_u64 used_request_bytes{0};
+  rx_u64 used_actual_bytes{0};
+  for (rx_size i{0}; i < k_shards; i++) {
+    const auto& shard{shard_at(i)};
+    result.allocations += shard.allocations.load(memory_order::k_relaxed);
+    result.request_reallocations += shard.request_reallocations.load(memory_order::k_relaxed);
+    result.actual_reallocations += shard.actual_reallocations.load(memory_order::k_relaxed);
+    result.deallocations += shard.deallocations.load(memory_order::k_relaxed);
+    used_request_bytes += shard.used_request_bytes.load(memory_order::k_relaxed);
+    used_actual_bytes += shard.used_actual_bytes.load(memory_order::k_relaxed);
+  }
+
+  // A deallocation on one shard can be seen before the allocation it frees
+  // on another, making the sum briefly negative.
+  result.used_request_bytes = static_cast<rx_s64>(used_request_bytes) > 0 ? used_request_bytes : 0;
+  result.used_actual_bytes = static_cast<rx_s64>(used_actual_bytes) > 0 ? used_actual_bytes : 0;
+
+  const rx_u64 peak_request_bytes{m_peak_request_bytes.load(memory_order::k_relaxed)};
+  const rx_u64 peak_actual_bytes{m_peak_actual_bytes.load(memory_order::k_relaxed)};
+  result.peak_request_bytes = peak_request_bytes > result.used_request_bytes
+    ? peak_request_bytes : result.used_request_bytes;
+  result.peak_actual_bytes = peak_actual_bytes > result.used_actual_bytes
+    ? peak_actual_bytes : result.used_actual_bytes;
+
+  return result;
+}
+
+void stats_allocator::add(shard& shard_, rx_u64 _request_bytes, rx_u64 _actual_bytes) {
+  shard_.used_request_bytes.fetch_add(_request_bytes, memory_order::k_relaxed);
+  const rx_u64 used{shard_.used_actual_bytes.fetch_add(_actual_bytes, memory_order::k_relaxed) + _actual_bytes};
+
+  // The totals are only computed when the shard grew by the granularity, which
+  // keeps them off the fast path. Threads sharing a shard may race on the mark,
+  // which only makes the peak update early or late.
+  const auto growth{static_cast<rx_s64>(used - shard_.peak_mark.load(memory_order::k_relaxed))};
+  if (growth < 0) {
+    shard_.peak_mark.store(used, memory_order::k_relaxed);
+  } else if (growth >= static_cast<rx_s64>(k_peak_granularity)) {
+    shard_.peak_mark.store(used, memory_order::k_relaxed);
+    update_peaks();
+  }
+}
+
+void stats_allocator::update_peaks() {
+  rx_u64 used_request_bytes{0};
+  rx_u64 used_actual_bytes{0};
+  for (rx_size i{0}; i < k_shards; i++) {
+    const auto& shard{shard_at(i)};
+    used_request_bytes += shard.used_request_bytes.load(memory_order::k_relaxed);
+    used_actual_bytes += shard.used_actual_bytes.load(memory_order::k_relaxed);
+  }
+
+  if (static_cast<rx_s64>(used_request_bytes) > 0) {
+    raise(m_peak_request_bytes, used_request_bytes);
+  }
+  if (static_cast<rx_s64>(used_actual_bytes) > 0) {
+    raise(m_peak_actual_bytes, used_actual_bytes);
+  }
 }
 
 } // namespace rx::memory
@@ -1,7 +1,9 @@
 #ifndef RX_CORE_MEMORY_STATS_ALLOCATOR_H
 #define RX_CORE_MEMORY_STATS_ALLOCATOR_H
 #include "rx/core/memory/allocator.h"
-#include "rx/core/concurrency/spin_lock.h"
+
+#include "rx/core/concurrency/atomic.h"
+#include "rx/core/concurrency/cache_line.h"
 
 namespace rx::memory {
 
@@ -13,9 +15,24 @@ namespace rx::memory {
 //
 // The purpose of this allocator is to provide a means to debug and track
 // information about any allocator.
+//
+// Counters are split in |k_shards| shards, each on its own cache line, and
+// every thread updates the shard it's assigned with relaxed atomics, so
+// threads allocating at once don't serialize on the counters. |stats| sums the
+// shards, which isn't a snapshot of a single point in time when other threads
+// allocate meanwhile.
+//
+// Bytes allocated on one shard may be freed on another, so a shard alone
+// can't tell the peak. A shard which grew by |k_peak_granularity| bytes since
+// it last did recomputes the total and raises the peak, which |stats| then
+// reconciles with the current total. A peak can be missed by at most
+// |k_peak_granularity| bytes for every shard.
 struct stats_allocator
   final : allocator
 {
+  static constexpr const rx_size k_shards{16};
+  static constexpr const rx_u64 k_peak_granularity{64 * 1024};
+
   constexpr stats_allocator() = delete;
   constexpr stats_allocator(allocator& _allocator);
 
@@ -43,14 +60,47 @@ struct stats_allocator
   statistics stats() const;
 
 private:
+  // Bytes are kept as unsigned sums which wrap around when a shard frees more
+  // than it allocated, the sum of every shard is exact.
+  struct shard {
+    concurrency::atomic<rx_size> allocations;
+    concurrency::atomic<rx_size> request_reallocations;
+    concurrency::atomic<rx_size> actual_reallocations;
+    concurrency::atomic<rx_size> deallocations;
+    concurrency::atomic<rx_u64> used_request_bytes;
+    concurrency::atomic<rx_u64> used_actual_bytes;
+
+    // Value of |used_actual_bytes| when the shard last updated the peaks.
+    concurrency::atomic<rx_u64> peak_mark;
+  };
+
+  // Keep each shard on it's own cache line to avoid false sharing between
+  // threads updating their own shards.
+  union padded_shard {
+    shard as_shard;
+    rx_byte as_padding[(sizeof(shard) + concurrency::k_cache_line - 1) & ~(concurrency::k_cache_line - 1)];
+  };
+
+  const shard& shard_at(rx_size _index) const;
+  shard& local_shard();
+  void add(shard& shard_, rx_u64 _request_bytes, rx_u64 _actual_bytes);
+  void update_peaks();
+
   allocator& m_allocator;
-  mutable concurrency::spin_lock m_lock;
-  statistics m_statistics; // protected by |m_lock|
+
+  // Over allocated by a cache line to align the shards on a cache line, since
+  // globals aren't aligned on more than |k_alignment|.
+  rx_byte m_shard_storage[sizeof(padded_shard) * k_shards + concurrency::k_cache_line];
+
+  concurrency::atomic<rx_u64> m_peak_request_bytes;
+  concurrency::atomic<rx_u64> m_peak_actual_bytes;
 };
 
 inline constexpr stats_allocator::stats_allocator(allocator& _allocator)
   : m_allocator{_allocator}
-  , m_statistics{}
+  , m_shard_storage{}
+  , m_peak_request_bytes{0}
+  , m_peak_actual_bytes{0}
 {
 }
 
@@ -7,6 +7,9 @@ namespace rx::memory {
 system_allocator::system_allocator()
 #if defined(RX_ESAN)
   : m_stats_allocator{electric_fence_allocator::instance()}
+#elif defined(RX_THREAD_CACHE_ALLOCATOR)
+  : m_thread_cache_allocator{heap_allocator::instance()}
+  , m_stats_allocator{m_thread_cache_allocator}
 #else
   : m_stats_allocator{heap_allocator::instance()}
 #endif
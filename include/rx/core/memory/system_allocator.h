@@ -1,6 +1,7 @@
 #ifndef RX_CORE_MEMORY_SYSTEM_ALLOCATOR_H
 #define RX_CORE_MEMORY_SYSTEM_ALLOCATOR_H
 #include "rx/core/memory/stats_allocator.h"
+#include "rx/core/memory/thread_cache_allocator.h"
 
 #include "rx/core/global.h"
 
@@ -12,6 +13,10 @@ namespace rx::memory {
 // allocator to track global system allocations. When something isn't provided
 // an allocator, this is the allocator used. More specifically, the global
 // g_system_allocator is used.
+//
+// Configuring with RX_THREAD_CACHE_ALLOCATOR puts a thread cache allocator
+// between the two, so small allocations from many threads don't contend on
+// the heap. Electric fence builds, configured with RX_ESAN, leave it out.
 struct system_allocator
   final : allocator
 {
@@ -26,6 +31,9 @@ struct system_allocator
   static constexpr allocator& instance();
 
 private:
+#if defined(RX_THREAD_CACHE_ALLOCATOR) && !defined(RX_ESAN)
+  thread_cache_allocator m_thread_cache_allocator;
+#endif
   stats_allocator m_stats_allocator;
 
   static global<system_allocator> s_instance;
@@ -0,0 +1,378 @@
+#include <string.h> // memcpy
+
+#include "rx/core/memory/thread_cache_allocator.h"
+
+#include "rx/core/concurrency/scope_lock.h"
+
+#include "rx/core/utility/bit.h"
+
+#include "rx/core/hints/likely.h"
+#include "rx/core/hints/unlikely.h"
+
+namespace rx::memory {
+
+static constexpr const rx_size k_page_size{4096};
+
+// Every slab starts with a header, padded to keep the blocks after it aligned
+// and off the cache line of the header.
+static constexpr const rx_size k_slab_header{64};
+
+// Size of the virtual memory reservation slabs come from.
+static constexpr const rx_size k_reservation{sizeof(void*) == 8 ? 64_z << 30 : 256_z << 20};
+
+// Bytes of free blocks moved in one batch between a thread and the central
+// free list, within the bounds of |k_min_batch| and |k_max_batch| blocks.
+static constexpr const rx_size k_batch_bytes{32 * 1024};
+static constexpr const rx_size k_min_batch{2};
+static constexpr const rx_size k_max_batch{64};
+
+struct thread_cache_allocator::block {
+  block* next;       // next block in a cache or batch
+  block* next_batch; // next batch in the central free list, first block only
+};
+
+struct slab {
+  rx_size size_class;
+};
+
+struct thread_cache_allocator::thread_cache {
+  struct bin {
+    block* head;
+    rx_size count; // approximate, only decides when to return a batch
+    rx_byte* bump; // the part of a slab of this thread not carved up yet
+    rx_byte* end;
+  };
+
+  thread_cache_allocator* owner; // protected by |g_caches_lock|
+  thread_cache* next_in_owner;   // protected by |g_caches_lock|
+  thread_cache* next_in_thread;
+  allocator* backing;
+  bin bins[k_size_classes];
+};
+
+// The caches of the calling thread for every allocator it used, returned to
+// their allocators when the thread exits.
+struct thread_caches {
+  ~thread_caches();
+  thread_cache_allocator::thread_cache* head;
+  thread_cache_allocator::thread_cache* last;
+};
+
+static concurrency::spin_lock g_caches_lock;
+static thread_local thread_caches t_caches;
+
+thread_caches::~thread_caches() {
+  while (auto cache = head) {
+    head = cache->next_in_thread;
+    {
+      concurrency::scope_lock lock{g_caches_lock};
+      if (cache->owner) {
+        cache->owner->release_cache(cache);
+      }
+    }
+    cache->backing->destroy<thread_cache_allocator::thread_cache>(cache);
+  }
+  last = nullptr;
+}
+
+thread_cache_allocator::thread_cache_allocator(allocator& _allocator)
+  : m_allocator{_allocator}
+  , m_base{nullptr}
+  , m_end{nullptr}
+  , m_next_slab{0}
+  , m_central{}
+  , m_caches{nullptr}
+{
+  // Reserve an extra slab to align the slabs on their size, which finds the
+  // header of a slab from any block in it.
+  const rx_size pages{(k_reservation + k_slab_size) / k_page_size};
+  if (RX_HINT_UNLIKELY(!m_reservation.allocate(k_page_size, pages))) {
+    return;
+  }
+
+  const auto base{reinterpret_cast<rx_uintptr>(m_reservation.base())};
+  m_base = reinterpret_cast<rx_byte*>((base + k_slab_size - 1) & ~(k_slab_size - 1));
+  m_end = m_base + k_reservation;
+}
+
+thread_cache_allocator::~thread_cache_allocator() {
+  // Threads still holding a cache free it when they exit.
+  concurrency::scope_lock lock{g_caches_lock};
+  for (auto cache = m_caches; cache; cache = cache->next_in_owner) {
+    cache->owner = nullptr;
+  }
+}
+
+rx_byte* thread_cache_allocator::allocate(rx_size _size) {
+  if (RX_HINT_LIKELY(_size <= k_max_size && m_base)) {
+    const rx_size index{size_class(_size)};
+    if (auto cache = local_cache()) {
+      auto& bin{cache->bins[index]};
+      if (RX_HINT_LIKELY(bin.head)) {
+        block* result{bin.head};
+        bin.head = result->next;
+        bin.count -= bin.count != 0;
+        return reinterpret_cast<rx_byte*>(result);
+      }
+      if (auto result = refill(cache, index)) {
+        return result;
+      }
+    }
+  }
+  return m_allocator.allocate(_size);
+}
+
+rx_byte* thread_cache_allocator::reallocate(void* _data, rx_size _size) {
+  if (RX_HINT_UNLIKELY(!_data)) {
+    return allocate(_size);
+  }
+
+  if (!owns(_data)) {
+    return m_allocator.reallocate(_data, _size);
+  }
+
+  // Still fits in the block.
+  const auto header{reinterpret_cast<slab*>(reinterpret_cast<rx_uintptr>(_data) & ~(k_slab_size - 1))};
+  const rx_size size{class_size(header->size_class)};
+  if (_size <= size) {
+    return reinterpret_cast<rx_byte*>(_data);
+  }
+
+  rx_byte* resize{allocate(_size)};
+  if (RX_HINT_UNLIKELY(!resize)) {
+    return nullptr;
+  }
+
+  memcpy(resize, _data, size);
+  deallocate(_data);
+  return resize;
+}
+
+void thread_cache_allocator::deallocate(void* _data) {
+  if (RX_HINT_UNLIKELY(!_data)) {
+    return;
+  }
+
+  if (!owns(_data)) {
+    m_allocator.deallocate(_data);
+    return;
+  }
+
+  const auto header{reinterpret_cast<slab*>(reinterpret_cast<rx_uintptr>(_data) & ~(k_slab_size - 1))};
+  const rx_size index{header->size_class};
+  auto item{reinterpret_cast<block*>(_data)};
+
+  auto cache{local_cache()};
+  if (RX_HINT_UNLIKELY(!cache)) {
+    // Without a cache return the block to the central free list on its own.
+    auto& central{m_central[index]};
+    item->next = nullptr;
+    concurrency::scope_lock lock{central.lock};
+    item->next_batch = central.batches;
+    central.batches = item;
+    return;
+  }
+
+  auto& bin{cache->bins[index]};
+  item->next = bin.head;
+  bin.head = item;
+
+  // Keep up to two batches so alternating allocations and deallocations at
+  // the limit don't move a batch back and forth every time.
+  const rx_size batch{batch_size(index)};
+  if (++bin.count > batch * 2) {
+    flush(cache, index, batch);
+  }
+}
+
+rx_size thread_cache_allocator::size_class(rx_size _size) {
+  // Steps of 16 bytes up to 256 bytes, then four steps per power of two.
+  if (_size <= 256) {
+    return _size ? (_size - 1) >> 4 : 0;
+  }
+  const rx_size bit{bit_search_msb(static_cast<rx_u64>(_size - 1))};
+  return 16 + (bit - 8) * 4 + (((_size - 1) >> (bit - 2)) - 4);
+}
+
+rx_size thread_cache_allocator::class_size(rx_size _size_class) {
+  if (_size_class < 16) {
+    return (_size_class + 1) << 4;
+  }
+  const rx_size bit{(_size_class - 16) / 4 + 8};
+  const rx_size step{(_size_class - 16) % 4};
+  return (5 + step) << (bit - 2);
+}
+
+rx_size thread_cache_allocator::batch_size(rx_size _size_class) {
+  const rx_size count{k_batch_bytes / class_size(_size_class)};
+  if (count < k_min_batch) {
+    return k_min_batch;
+  }
+  return count > k_max_batch ? k_max_batch : count;
+}
+
+thread_cache_allocator::thread_cache* thread_cache_allocator::local_cache() {
+  auto cache{t_caches.last};
+  if (RX_HINT_LIKELY(cache && cache->owner == this)) {
+    return cache;
+  }
+
+  for (cache = t_caches.head; cache; cache = cache->next_in_thread) {
+    if (cache->owner == this) {
+      t_caches.last = cache;
+      return cache;
+    }
+  }
+
+  return create_cache();
+}
+
+thread_cache_allocator::thread_cache* thread_cache_allocator::create_cache() {
+  auto cache{m_allocator.create<thread_cache>()};
+  if (RX_HINT_UNLIKELY(!cache)) {
+    return nullptr;
+  }
+
+  for (rx_size i{0}; i < k_size_classes; i++) {
+    cache->bins[i] = {nullptr, 0, nullptr, nullptr};
+  }
+
+  cache->backing = &m_allocator;
+  {
+    concurrency::scope_lock lock{g_caches_lock};
+    cache->owner = this;
+    cache->next_in_owner = m_caches;
+    m_caches = cache;
+  }
+
+  cache->next_in_thread = t_caches.head;
+  t_caches.head = cache;
+  t_caches.last = cache;
+
+  return cache;
+}
+
+void thread_cache_allocator::release_cache(thread_cache* _cache) {
+  // Called with |g_caches_lock| held.
+  for (rx_size i{0}; i < k_size_classes; i++) {
+    auto& bin{_cache->bins[i]};
+
+    // Carve what's left of the slab of the thread into blocks so it's reused.
+    const rx_size size{class_size(i)};
+    while (static_cast<rx_size>(bin.end - bin.bump) >= size) {
+      auto item{reinterpret_cast<block*>(bin.bump)};
+      item->next = bin.head;
+      bin.head = item;
+      bin.bump += size;
+    }
+
+    const rx_size batch{batch_size(i)};
+    while (bin.head) {
+      flush(_cache, i, batch);
+    }
+  }
+
+  for (auto next = &m_caches; *next; next = &(*next)->next_in_owner) {
+    if (*next == _cache) {
+      *next = _cache->next_in_owner;
+      break;
+    }
+  }
+  _cache->owner = nullptr;
+}
+
+rx_byte* thread_cache_allocator::refill(thread_cache* _cache, rx_size _size_class) {
+  auto& bin{_cache->bins[_size_class]};
+  const rx_size size{class_size(_size_class)};
+
+  // Carve from the slab of the thread first, which doesn't take a lock. Blocks
+  // freed by other threads are reused once the slab runs out.
+  if (static_cast<rx_size>(bin.end - bin.bump) < size) {
+    block* batch{nullptr};
+    {
+      auto& central{m_central[_size_class]};
+      concurrency::scope_lock lock{central.lock};
+      if ((batch = central.batches)) {
+        central.batches = batch->next_batch;
+      }
+    }
+
+    if (batch) {
+      bin.head = batch->next;
+      bin.count = batch_size(_size_class) - 1;
+      return reinterpret_cast<rx_byte*>(batch);
+    }
+
+    rx_byte* data{allocate_slab(_size_class)};
+    if (RX_HINT_UNLIKELY(!data)) {
+      return nullptr;
+    }
+    bin.bump = data + k_slab_header;
+    bin.end = data + k_slab_size;
+  }
+
+  // Carve a whole batch at once so the next allocations take it from the
+  // cache.
+  rx_byte* result{bin.bump};
+  bin.bump += size;
+
+  const rx_size batch{batch_size(_size_class)};
+  rx_size count{0};
+  while (count < batch - 1 && static_cast<rx_size>(bin.end - bin.bump) >= size) {
+    auto item{reinterpret_cast<block*>(bin.bump)};
+    item->next = bin.head;
+    bin.head = item;
+    bin.bump += size;
+    count++;
+  }
+  bin.count += count;
+
+  return result;
+}
+
+void thread_cache_allocator::flush(thread_cache* _cache, rx_size _size_class,
+  rx_size _count)
+{
+  auto& bin{_cache->bins[_size_class]};
+
+  // Detach up to |_count| blocks from the front of the cache as a batch.
+  block* first{bin.head};
+  block* last{first};
+  rx_size count{1};
+  while (count < _count && last->next) {
+    last = last->next;
+    count++;
+  }
+
+  bin.head = last->next;
+  bin.count = bin.count > count ? bin.count - count : 0;
+  last->next = nullptr;
+
+  auto& central{m_central[_size_class]};
+  concurrency::scope_lock lock{central.lock};
+  first->next_batch = central.batches;
+  central.batches = first;
+}
+
+rx_byte* thread_cache_allocator::allocate_slab(rx_size _size_class) {
+  const rx_size index{m_next_slab.fetch_add(1, concurrency::memory_order::k_relaxed)};
+  if (RX_HINT_UNLIKELY(index >= k_reservation / k_slab_size)) {
+    return nullptr;
+  }
+
+  rx_byte* data{m_base + index * k_slab_size};
+  const rx_size offset{static_cast<rx_size>(data - m_reservation.base()) / k_page_size};
+  if (RX_HINT_UNLIKELY(!m_reservation.commit({offset, k_slab_size / k_page_size}, true, true))) {
+    return nullptr;
+  }
+
+  reinterpret_cast<slab*>(data)->size_class = _size_class;
+  return data;
+}
+
+bool thread_cache_allocator::owns(const void* _data) const {
+  const auto data{reinterpret_cast<const rx_byte*>(_data)};
+  return data >= m_base && data < m_end;
+}
+
+} // namespace rx::memory
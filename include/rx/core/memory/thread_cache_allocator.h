@@ -0,0 +1,95 @@
+#ifndef RX_CORE_MEMORY_THREAD_CACHE_ALLOCATOR_H
+#define RX_CORE_MEMORY_THREAD_CACHE_ALLOCATOR_H
+#include "rx/core/memory/allocator.h"
+#include "rx/core/memory/vma.h"
+
+#include "rx/core/concurrency/spin_lock.h"
+#include "rx/core/concurrency/atomic.h"
+
+namespace rx::memory {
+
+// # Thread Cache Allocator
+//
+// Size class allocator with a cache per thread, for allocation heavy code
+// running on many threads at once.
+//
+// Small allocations are rounded up to one of |k_size_classes| size classes
+// and come from slabs of |k_slab_size| bytes, each slab holding blocks of a
+// single size class. Slabs are carved out of a single large virtual memory
+// reservation which is committed one slab at a time as it's needed.
+//
+// Every thread keeps a cache of free blocks for every size class. Allocating
+// and deallocating a small block only touches the calling thread's cache,
+// without a lock or a syscall. When a thread's cache runs empty it carves a
+// batch of new blocks from the slab it owns, and once the slab is used up
+// takes a batch of blocks from a central free list of the size class before
+// starting a new slab. When it holds too many free blocks it returns a
+// batch to the central free list. Only those batched transfers take the lock
+// of the size class. A thread exiting returns all of its cached blocks.
+//
+// Allocations larger than |k_max_size| go to |_allocator|, as does everything
+// when the reservation can't be made or is exhausted.
+//
+// Slabs aren't returned to the operating system before the allocator is
+// destroyed, memory freed to the allocator is only reused by it.
+struct thread_cache_allocator
+  final : allocator
+{
+  static constexpr const rx_size k_size_classes{44};
+  static constexpr const rx_size k_max_size{32768};
+  static constexpr const rx_size k_slab_size{256 * 1024};
+
+  thread_cache_allocator() = delete;
+  thread_cache_allocator(allocator& _allocator);
+  ~thread_cache_allocator();
+
+  virtual rx_byte* allocate(rx_size _size);
+  virtual rx_byte* reallocate(void* _data, rx_size _size);
+  virtual void deallocate(void* _data);
+
+private:
+  struct block;
+  struct thread_cache;
+
+  // Size class of an allocation of |_size| bytes.
+  static rx_size size_class(rx_size _size);
+  static rx_size class_size(rx_size _size_class);
+  static rx_size batch_size(rx_size _size_class);
+
+  thread_cache* local_cache();
+  thread_cache* create_cache();
+  void release_cache(thread_cache* _cache);
+
+  rx_byte* refill(thread_cache* _cache, rx_size _size_class);
+  void flush(thread_cache* _cache, rx_size _size_class, rx_size _count);
+  rx_byte* allocate_slab(rx_size _size_class);
+
+  bool owns(const void* _data) const;
+
+  friend struct thread_caches;
+
+  allocator& m_allocator;
+
+  vma m_reservation;
+  rx_byte* m_base;
+  rx_byte* m_end;
+
+  // Index of the next slab to commit.
+  concurrency::atomic<rx_size> m_next_slab;
+
+  // Batches of free blocks returned by threads for every size class.
+  struct central_list {
+    concurrency::spin_lock lock;
+    block* batches; // protected by |lock|
+  };
+
+  central_list m_central[k_size_classes];
+
+  // Caches of every thread using the allocator, protected by a lock shared by
+  // every instance since threads outlive allocators and the other way around.
+  thread_cache* m_caches;
+};
+
+} // namespace rx::memory
+
+#endif // RX_CORE_MEMORY_THREAD_CACHE_ALLOCATOR_H
@@ -0,0 +1,389 @@
+#include <inttypes.h> // PRIu64, PRIxPTR
+#include <string.h> // memset
+
+#include "rx/core/memory/tracking_allocator.h"
+#include "rx/core/concurrency/scope_lock.h"
+
+#include "rx/core/algorithm/quick_sort.h"
+
+#include "rx/core/time/qpc.h"
+
+#include "rx/core/utility/bit.h"
+#include "rx/core/utility/move.h"
+
+#include "rx/core/hints/unlikely.h"
+#include "rx/core/hints/likely.h"
+
+#include "rx/core/assert.h"
+
+namespace rx::memory {
+
+using concurrency::memory_order;
+
+// Threads are assigned shards in the order they first allocate.
+static concurrency::atomic<rx_size> g_next_shard{0};
+static thread_local const rx_size t_shard{
+  g_next_shard.fetch_add(1, memory_order::k_relaxed) % tracking_allocator::k_shards};
+
+// Bytes the thread allocates before it samples, the first allocation of every
+// thread is sampled.
+static thread_local rx_s64 t_countdown{0};
+static thread_local rx_u64 t_random{0};
+
+static thread_local const char* t_tag{nullptr};
+
+struct tracking_allocator::sample {
+  call_site site;
+  rx_u64 ticks;
+  rx_u64 weight;
+};
+
+// Each allocation is prefixed with this header.
+struct alignas(allocator::k_alignment) tracking_allocator::header {
+  sample* record; // nullptr when not sampled
+};
+
+static rx_size size_class_of(rx_size _size) {
+  return _size ? bit_search_msb(static_cast<rx_u64>(_size)) + 1 : 0;
+}
+
+static rx_size lifetime_bucket_of(rx_u64 _ticks) {
+  const auto nanoseconds{static_cast<rx_u64>(
+    static_cast<rx_f64>(_ticks) * 1000000000.0 / time::qpc_frequency())};
+  if (!nanoseconds) {
+    return 0;
+  }
+  const rx_size bucket{bit_search_msb(nanoseconds) + 1};
+  return bucket < tracking_allocator::k_lifetime_buckets
+    ? bucket : tracking_allocator::k_lifetime_buckets - 1;
+}
+
+// Uniform in [1, 2 * |_interval|], which averages |_interval|.
+static rx_s64 next_countdown(rx_size _interval) {
+  if (RX_HINT_UNLIKELY(!t_random)) {
+    t_random = reinterpret_cast<rx_uintptr>(&t_random) | 1;
+  }
+
+  // xorshift64
+  t_random ^= t_random << 13;
+  t_random ^= t_random >> 7;
+  t_random ^= t_random << 17;
+
+  return static_cast<rx_s64>(1 + t_random % (_interval * 2));
+}
+
+tracking_allocator::tracking_allocator(allocator& _allocator, rx_size _sample_interval)
+  : m_allocator{_allocator}
+  , m_sample_interval{_sample_interval}
+  , m_shard_storage{nullptr}
+  , m_sites{_allocator}
+{
+  RX_ASSERT(_sample_interval, "_sample_interval must not be zero");
+
+  const rx_size size{sizeof(padded_shard) * k_shards + concurrency::k_cache_line};
+  m_shard_storage = m_allocator.allocate(size);
+  RX_ASSERT(m_shard_storage, "out of memory");
+  memset(m_shard_storage, 0, size);
+}
+
+tracking_allocator::~tracking_allocator() {
+  m_allocator.deallocate(m_shard_storage);
+}
+
+rx_byte* tracking_allocator::allocate(rx_size _size) {
+  return allocate(_size, RX_RETURN_ADDRESS());
+}
+
+rx_byte* tracking_allocator::reallocate(void* _data, rx_size _size) {
+  return reallocate(_data, _size, RX_RETURN_ADDRESS());
+}
+
+rx_byte* tracking_allocator::allocate(rx_size _size, rx_uintptr _return_address) {
+  rx_byte* base{m_allocator.allocate(_size + sizeof(header))};
+  if (RX_HINT_UNLIKELY(!base)) {
+    return nullptr;
+  }
+
+  count(_size);
+
+  const auto node{reinterpret_cast<header*>(base)};
+  node->record = take_sample(_size, _return_address);
+
+  return reinterpret_cast<rx_byte*>(node + 1);
+}
+
+rx_byte* tracking_allocator::reallocate(void* _data, rx_size _size, rx_uintptr _return_address) {
+  if (RX_HINT_UNLIKELY(!_data)) {
+    return allocate(_size, _return_address);
+  }
+
+  rx_byte* resize{m_allocator.reallocate(reinterpret_cast<header*>(_data) - 1,
+    _size + sizeof(header))};
+  if (RX_HINT_UNLIKELY(!resize)) {
+    return nullptr;
+  }
+
+  count(_size);
+
+  // A reallocation stays with the call site which allocated it.
+  const auto node{reinterpret_cast<header*>(resize)};
+  if (node->record) {
+    resize_sample(node->record, _size);
+  }
+
+  return reinterpret_cast<rx_byte*>(node + 1);
+}
+
+void tracking_allocator::deallocate(void* _data) {
+  if (RX_HINT_UNLIKELY(!_data)) {
+    return;
+  }
+
+  const auto node{reinterpret_cast<header*>(_data) - 1};
+  if (node->record) {
+    free_sample(node->record);
+  }
+
+  m_allocator.deallocate(node);
+}
+
+tracking_allocator::snapshot tracking_allocator::capture() const {
+  snapshot result{m_allocator};
+  result.sample_interval = m_sample_interval;
+
+  for (rx_size i{0}; i < k_shards; i++) {
+    const auto& shard{shard_at(i)};
+    for (rx_size j{0}; j < k_size_classes; j++) {
+      result.size_classes[j] += shard.size_classes[j].load(memory_order::k_relaxed);
+    }
+  }
+
+  {
+    concurrency::scope_lock lock{m_lock};
+    result.sites.reserve(m_sites.size());
+    m_sites.each_value([&](const site_statistics& _site) {
+      result.sites.push_back(_site);
+    });
+  }
+
+  // There are few tags, search them linearly.
+  result.sites.each_fwd([&](const site_statistics& _site) {
+    tag_statistics* tag{nullptr};
+    result.tags.each_fwd([&](tag_statistics& tag_) {
+      if (tag_.tag == _site.site.tag) {
+        tag = &tag_;
+        return false;
+      }
+      return true;
+    });
+
+    if (!tag) {
+      result.tags.push_back({_site.site.tag, 0, 0});
+      tag = &result.tags.last();
+    }
+
+    tag->live_samples += _site.live_samples;
+    tag->live_bytes += _site.live_bytes;
+  });
+
+  if (!result.sites.is_empty()) {
+    algorithm::quick_sort(result.sites.data(), result.sites.data() + result.sites.size(),
+      [](const site_statistics& _lhs, const site_statistics& _rhs) {
+        return _lhs.live_bytes > _rhs.live_bytes;
+      });
+  }
+
+  if (!result.tags.is_empty()) {
+    algorithm::quick_sort(result.tags.data(), result.tags.data() + result.tags.size(),
+      [](const tag_statistics& _lhs, const tag_statistics& _rhs) {
+        return _lhs.live_bytes > _rhs.live_bytes;
+      });
+  }
+
+  return result;
+}
+
+RX_HINT_FORCE_INLINE const tracking_allocator::shard& tracking_allocator::shard_at(rx_size _index) const {
+  const auto address{reinterpret_cast<rx_uintptr>(m_shard_storage)};
+  const auto aligned{(address + concurrency::k_cache_line - 1) & ~(concurrency::k_cache_line - 1)};
+  return reinterpret_cast<const padded_shard*>(aligned)[_index].as_shard;
+}
+
+RX_HINT_FORCE_INLINE void tracking_allocator::count(rx_size _size) {
+  auto& shard{const_cast<tracking_allocator::shard&>(shard_at(t_shard))};
+  shard.size_classes[size_class_of(_size)].fetch_add(1, memory_order::k_relaxed);
+}
+
+tracking_allocator::sample* tracking_allocator::take_sample(rx_size _size, rx_uintptr _return_address) {
+  t_countdown -= static_cast<rx_s64>(_size);
+  if (RX_HINT_LIKELY(t_countdown > 0)) {
+    return nullptr;
+  }
+
+  t_countdown = next_countdown(m_sample_interval);
+
+  // Not sampling when out of memory for the sample loses nothing but the sample.
+  auto record{reinterpret_cast<sample*>(m_allocator.allocate(sizeof(sample)))};
+  if (RX_HINT_UNLIKELY(!record)) {
+    return nullptr;
+  }
+
+  record->site = {t_tag, _return_address};
+  record->ticks = time::qpc_ticks();
+  record->weight = _size > m_sample_interval ? _size : m_sample_interval;
+
+  concurrency::scope_lock lock{m_lock};
+  auto site{m_sites.find(record->site)};
+  if (!site) {
+    site_statistics statistics{};
+    statistics.site = record->site;
+    site = m_sites.insert(record->site, utility::move(statistics));
+    if (RX_HINT_UNLIKELY(!site)) {
+      m_allocator.deallocate(record);
+      return nullptr;
+    }
+  }
+
+  site->samples++;
+  site->bytes += record->weight;
+  site->live_samples++;
+  site->live_bytes += record->weight;
+
+  return record;
+}
+
+void tracking_allocator::resize_sample(sample* sample_, rx_size _size) {
+  const rx_u64 weight{_size > m_sample_interval ? _size : m_sample_interval};
+
+  concurrency::scope_lock lock{m_lock};
+  auto site{m_sites.find(sample_->site)};
+  RX_ASSERT(site, "sample without a call site");
+
+  if (weight > sample_->weight) {
+    site->bytes += weight - sample_->weight;
+  }
+  site->live_bytes -= sample_->weight;
+  site->live_bytes += weight;
+
+  sample_->weight = weight;
+}
+
+void tracking_allocator::free_sample(sample* _sample) {
+  const rx_size bucket{lifetime_bucket_of(time::qpc_ticks() - _sample->ticks)};
+
+  {
+    concurrency::scope_lock lock{m_lock};
+    auto site{m_sites.find(_sample->site)};
+    RX_ASSERT(site, "sample without a call site");
+
+    site->live_samples--;
+    site->live_bytes -= _sample->weight;
+    site->lifetimes[bucket]++;
+  }
+
+  m_allocator.deallocate(_sample);
+}
+
+tracking_allocator::tag_scope::tag_scope(const char* _tag)
+  : m_previous{t_tag}
+{
+  t_tag = _tag;
+}
+
+tracking_allocator::tag_scope::~tag_scope() {
+  t_tag = m_previous;
+}
+
+tracking_allocator::snapshot::snapshot(allocator& _allocator)
+  : sample_interval{0}
+  , size_classes{}
+  , sites{_allocator}
+  , tags{_allocator}
+{
+}
+
+static void append_tag(string& json_, const char* _tag) {
+  if (!_tag) {
+    json_.append("null");
+    return;
+  }
+
+  json_.append('"');
+  for (const char* ch{_tag}; *ch; ch++) {
+    switch (*ch) {
+    case '"':
+      json_.append("\\\"");
+      break;
+    case '\\':
+      json_.append("\\\\");
+      break;
+    default:
+      if (static_cast<unsigned char>(*ch) < 0x20) {
+        json_.append(string::format(json_.allocator(), "\\u%04x", *ch));
+      } else {
+        json_.append(*ch);
+      }
+      break;
+    }
+  }
+  json_.append('"');
+}
+
+string tracking_allocator::snapshot::to_json() const {
+  auto& allocator{sites.allocator()};
+  string json{allocator};
+
+  json.append(string::format(allocator, "{\"sample_interval\":%zu,\"size_classes\":[",
+    sample_interval));
+
+  // Only the size classes which were allocated from.
+  bool first{true};
+  for (rx_size i{0}; i < k_size_classes; i++) {
+    if (!size_classes[i]) {
+      continue;
+    }
+    json.append(string::format(allocator,
+      "%s{\"min_size\":%" PRIu64 ",\"count\":%" PRIu64 "}",
+      first ? "" : ",", i ? 1_u64 << (i - 1) : 0_u64, size_classes[i]));
+    first = false;
+  }
+
+  json.append("],\"tags\":[");
+  tags.each_fwd([&](const tag_statistics& _tag) {
+    json.append(&_tag == tags.data() ? "{\"tag\":" : ",{\"tag\":");
+    append_tag(json, _tag.tag);
+    json.append(string::format(allocator,
+      ",\"live_samples\":%" PRIu64 ",\"live_bytes\":%" PRIu64 "}",
+      _tag.live_samples, _tag.live_bytes));
+  });
+
+  json.append("],\"sites\":[");
+  sites.each_fwd([&](const site_statistics& _site) {
+    json.append(&_site == sites.data() ? "{\"tag\":" : ",{\"tag\":");
+    append_tag(json, _site.site.tag);
+    json.append(string::format(allocator,
+      ",\"address\":\"0x%" PRIxPTR "\",\"samples\":%" PRIu64 ",\"bytes\":%" PRIu64
+      ",\"live_samples\":%" PRIu64 ",\"live_bytes\":%" PRIu64 ",\"lifetimes\":[",
+      _site.site.address, _site.samples, _site.bytes, _site.live_samples,
+      _site.live_bytes));
+
+    // Only the lifetime buckets which were hit, in nanoseconds.
+    bool first_bucket{true};
+    for (rx_size i{0}; i < k_lifetime_buckets; i++) {
+      if (!_site.lifetimes[i]) {
+        continue;
+      }
+      json.append(string::format(allocator,
+        "%s{\"min_ns\":%" PRIu64 ",\"count\":%" PRIu64 "}",
+        first_bucket ? "" : ",", i ? 1_u64 << (i - 1) : 0_u64, _site.lifetimes[i]));
+      first_bucket = false;
+    }
+
+    json.append("]}");
+  });
+
+  json.append("]}");
+  return json;
+}
+
+} // namespace rx::memory
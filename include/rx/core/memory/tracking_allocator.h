@@ -0,0 +1,195 @@
+#ifndef RX_CORE_MEMORY_TRACKING_ALLOCATOR_H
+#define RX_CORE_MEMORY_TRACKING_ALLOCATOR_H
+#include "rx/core/memory/allocator.h"
+#include "rx/core/concurrency/spin_lock.h"
+#include "rx/core/concurrency/atomic.h"
+#include "rx/core/concurrency/cache_line.h"
+
+#include "rx/core/concepts/no_copy.h"
+#include "rx/core/concepts/no_move.h"
+
+#include "rx/core/hints/empty_bases.h"
+#include "rx/core/hints/force_inline.h"
+
+#include "rx/core/config.h" // RX_COMPILER_MSVC
+#include "rx/core/hash.h"
+#include "rx/core/map.h"
+#include "rx/core/vector.h"
+#include "rx/core/string.h"
+
+#if defined(RX_COMPILER_MSVC)
+#include <intrin.h> // _ReturnAddress
+#define RX_RETURN_ADDRESS() \
+  reinterpret_cast<::rx_uintptr>(_ReturnAddress())
+#else
+#define RX_RETURN_ADDRESS() \
+  reinterpret_cast<::rx_uintptr>(__builtin_return_address(0))
+#endif
+
+namespace rx::memory {
+
+// # Tracking Allocator
+//
+// Wraps an existing allocator to profile how it's used: which sizes are
+// allocated, from where, by which part of the program and for how long.
+//
+// Every allocation is counted in a histogram of size classes, one for every
+// power of two. The counters are sharded by thread like those of the stats
+// allocator so they stay cheap to update.
+//
+// Call sites are sampled. Each thread counts down the bytes it allocates and
+// samples the allocation which takes the count below zero, then restarts the
+// count at a random interval averaging |_sample_interval| bytes. Allocations
+// as large as the interval are always sampled and smaller ones in proportion
+// to their size, so each sample stands for |_sample_interval| bytes, or its
+// own size when larger. Allocations which aren't sampled only pay for the
+// countdown and the histogram.
+//
+// A sample records the address the allocation was made from and the tag of
+// the innermost |tag_scope| active on the thread. Tags are compared by
+// address, so they should be string literals, like a subsystem name or
+// |RX_FUNCTION|. Freeing a sampled allocation adds how long it lived to a
+// histogram of lifetimes of its call site.
+//
+// |capture| takes a snapshot of the histograms and of the estimated bytes
+// every call site and tag holds, which |snapshot::to_json| writes out.
+//
+// Every allocation is prefixed with a header of |k_alignment| bytes.
+struct tracking_allocator
+  final : allocator
+{
+  static constexpr const rx_size k_sample_interval{512 * 1024};
+  static constexpr const rx_size k_shards{16};
+
+  // Size class N holds sizes in [2^(N-1), 2^N), size class 0 holds empty sizes.
+  static constexpr const rx_size k_size_classes{sizeof(rx_size) * 8 + 1};
+
+  // Lifetime bucket N holds lifetimes in [2^(N-1), 2^N) nanoseconds.
+  static constexpr const rx_size k_lifetime_buckets{48};
+
+  tracking_allocator() = delete;
+  tracking_allocator(allocator& _allocator, rx_size _sample_interval);
+  tracking_allocator(allocator& _allocator);
+  ~tracking_allocator();
+
+  virtual rx_byte* allocate(rx_size _size);
+  virtual rx_byte* reallocate(void* _data, rx_size _size);
+  virtual void deallocate(void* _data);
+
+  // Same as above with the address to record for sampled allocations, for
+  // allocators forwarding to this one.
+  rx_byte* allocate(rx_size _size, rx_uintptr _return_address);
+  rx_byte* reallocate(void* _data, rx_size _size, rx_uintptr _return_address);
+
+  struct tag_scope;
+
+  struct call_site {
+    const char* tag;     // Tag active when allocated, nullptr when untagged
+    rx_uintptr address;  // Return address of the call to allocate
+
+    bool operator==(const call_site& _site) const;
+    rx_size hash() const;
+  };
+
+  struct site_statistics {
+    call_site site;
+    rx_u64 samples;      // Number of sampled allocations
+    rx_u64 bytes;        // Estimated bytes allocated
+    rx_u64 live_samples; // Number of sampled allocations not freed yet
+    rx_u64 live_bytes;   // Estimated bytes not freed yet
+
+    // Number of freed samples by lifetime bucket.
+    rx_u64 lifetimes[k_lifetime_buckets];
+  };
+
+  struct tag_statistics {
+    const char* tag;
+    rx_u64 live_samples;
+    rx_u64 live_bytes;
+  };
+
+  struct snapshot {
+    snapshot(allocator& _allocator);
+
+    rx_size sample_interval;
+
+    // Number of allocations and reallocations by size class.
+    rx_u64 size_classes[k_size_classes];
+
+    // Ordered by estimated live bytes, largest first.
+    vector<site_statistics> sites;
+    vector<tag_statistics> tags;
+
+    string to_json() const;
+  };
+
+  snapshot capture() const;
+
+  constexpr allocator& parent() const;
+
+private:
+  struct sample;
+  struct header;
+
+  struct shard {
+    concurrency::atomic<rx_u64> size_classes[k_size_classes];
+  };
+
+  // Keep each shard on it's own cache line to avoid false sharing between
+  // threads updating their own shards.
+  union padded_shard {
+    shard as_shard;
+    rx_byte as_padding[(sizeof(shard) + concurrency::k_cache_line - 1) & ~(concurrency::k_cache_line - 1)];
+  };
+
+  const shard& shard_at(rx_size _index) const;
+  void count(rx_size _size);
+
+  sample* take_sample(rx_size _size, rx_uintptr _return_address);
+  void resize_sample(sample* sample_, rx_size _size);
+  void free_sample(sample* _sample);
+
+  allocator& m_allocator;
+  rx_size m_sample_interval;
+
+  // Over allocated by a cache line to align the shards on a cache line.
+  rx_byte* m_shard_storage;
+
+  mutable concurrency::spin_lock m_lock;
+  map<call_site, site_statistics> m_sites; // protected by |m_lock|
+};
+
+// Tags the allocations made by the calling thread while the scope is alive.
+// Scopes nest, the innermost tag is recorded.
+struct RX_HINT_EMPTY_BASES tracking_allocator::tag_scope
+  : concepts::no_copy
+  , concepts::no_move
+{
+  tag_scope(const char* _tag);
+  ~tag_scope();
+
+private:
+  const char* m_previous;
+};
+
+inline tracking_allocator::tracking_allocator(allocator& _allocator)
+  : tracking_allocator{_allocator, k_sample_interval}
+{
+}
+
+RX_HINT_FORCE_INLINE constexpr allocator& tracking_allocator::parent() const {
+  return m_allocator;
+}
+
+inline bool tracking_allocator::call_site::operator==(const call_site& _site) const {
+  return tag == _site.tag && address == _site.address;
+}
+
+inline rx_size tracking_allocator::call_site::hash() const {
+  return hash_combine(rx::hash<rx_u64>{}(reinterpret_cast<rx_uintptr>(tag)),
+    rx::hash<rx_u64>{}(address));
+}
+
+} // namespace rx::memory
+
+#endif // RX_CORE_MEMORY_TRACKING_ALLOCATOR_H
@@ -1,6 +1,9 @@
+#include <string.h> // memcpy, memset
+
 #include "rx/core/static_pool.h"
 
 #include "rx/core/utility/exchange.h"
+#include "rx/core/utility/bit.h"
 
 namespace rx {
 
@@ -8,45 +11,118 @@ static_pool::static_pool(memory::allocator& _allocator, rx_size _object_size, rx
   : m_allocator{_allocator}
   , m_object_size{memory::allocator::round_to_alignment(_object_size)}
   , m_capacity{_capacity}
+  , m_size{0}
   , m_data{allocator().allocate(m_object_size * m_capacity)}
-  , m_bitset{allocator(), m_capacity}
+  , m_bitmap{nullptr}
+  , m_levels{0}
+  , m_level_offsets{}
 {
+  // Lay out one level after another until a level fits in a single word.
+  rx_size words{0};
+  rx_size bits{m_capacity};
+  do {
+    const rx_size level_words{(bits + k_word_bits - 1) / k_word_bits};
+    m_level_offsets[m_levels++] = words;
+    words += level_words ? level_words : 1;
+    bits = level_words;
+  } while (bits > 1);
+
+  m_bitmap = reinterpret_cast<word*>(allocator().allocate(words * sizeof(word)));
+  RX_ASSERT(m_bitmap, "out of memory");
+  memset(m_bitmap, 0, words * sizeof(word));
+
+  // Every object is free, so is every word of every level.
+  bits = m_capacity;
+  for (rx_size level{0}; level < m_levels; level++) {
+    word* level_bits{m_bitmap + m_level_offsets[level]};
+    for (rx_size i{0}; i < bits / k_word_bits; i++) {
+      level_bits[i] = ~word{0};
+    }
+    if (bits % k_word_bits) {
+      level_bits[bits / k_word_bits] = (word{1} << (bits % k_word_bits)) - 1;
+    }
+    bits = (bits + k_word_bits - 1) / k_word_bits;
+  }
 }
 
 static_pool::static_pool(static_pool&& pool_)
   : m_allocator{pool_.m_allocator}
   , m_object_size{utility::exchange(pool_.m_object_size, 0)}
   , m_capacity{utility::exchange(pool_.m_capacity, 0)}
+  , m_size{utility::exchange(pool_.m_size, 0)}
   , m_data{utility::exchange(pool_.m_data, nullptr)}
-  , m_bitset{utility::move(pool_.m_bitset)}
+  , m_bitmap{utility::exchange(pool_.m_bitmap, nullptr)}
+  , m_levels{utility::exchange(pool_.m_levels, 0)}
 {
+  memcpy(m_level_offsets, pool_.m_level_offsets, sizeof m_level_offsets);
 }
 
 static_pool& static_pool::operator=(static_pool&& pool_) {
   RX_ASSERT(&pool_ != this, "self assignment");
 
+  release();
+
   m_allocator = pool_.m_allocator;
   m_object_size = utility::exchange(pool_.m_object_size, 0);
   m_capacity = utility::exchange(pool_.m_capacity, 0);
+  m_size = utility::exchange(pool_.m_size, 0);
   m_data = utility::exchange(pool_.m_data, nullptr);
-  m_bitset = utility::move(pool_.m_bitset);
+  m_bitmap = utility::exchange(pool_.m_bitmap, nullptr);
+  m_levels = utility::exchange(pool_.m_levels, 0);
+  memcpy(m_level_offsets, pool_.m_level_offsets, sizeof m_level_offsets);
 
   return *this;
 }
 
 rx_size static_pool::allocate() {
-  const rx_size index{m_bitset.find_first_unset()};
-  if (RX_HINT_UNLIKELY(index == -1_z)) {
+  if (RX_HINT_UNLIKELY(m_size == m_capacity)) {
     return -1_z;
   }
 
-  m_bitset.set(index);
+  // Descend to the lowest free object.
+  rx_size index{0};
+  for (rx_size level{m_levels}; level-- > 0;) {
+    index = index * k_word_bits + bit_search_lsb(m_bitmap[m_level_offsets[level] + index]);
+  }
+
+  // Clear its bit, and the bits of words which became full in the levels above.
+  rx_size bit{index};
+  for (rx_size level{0}; level < m_levels; level++) {
+    word& bits{m_bitmap[m_level_offsets[level] + bit / k_word_bits]};
+    bits &= ~(word{1} << (bit % k_word_bits));
+    if (bits) {
+      break;
+    }
+    bit /= k_word_bits;
+  }
+
+  m_size++;
   return index;
 }
 
 void static_pool::deallocate(rx_size _index) {
-  RX_ASSERT(m_bitset.test(_index), "unallocated");
-  m_bitset.clear(_index);
+  RX_ASSERT(is_allocated(_index), "unallocated");
+
+  // Set its bit, and the bits of words which stopped being full in the levels
+  // above.
+  rx_size bit{_index};
+  for (rx_size level{0}; level < m_levels; level++) {
+    word& bits{m_bitmap[m_level_offsets[level] + bit / k_word_bits]};
+    const bool was_full{!bits};
+    bits |= word{1} << (bit % k_word_bits);
+    if (!was_full) {
+      break;
+    }
+    bit /= k_word_bits;
+  }
+
+  m_size--;
+}
+
+void static_pool::release() {
+  RX_ASSERT(m_size == 0, "leaked objects");
+  allocator().deallocate(m_data);
+  allocator().deallocate(m_bitmap);
 }
 
 } // namespace rx
@@ -1,13 +1,29 @@
 #ifndef RX_CORE_STATIC_POOL_H
 #define RX_CORE_STATIC_POOL_H
-#include "rx/core/bitset.h"
+#include "rx/core/ref.h"
 #include "rx/core/assert.h"
 
+#include "rx/core/memory/system_allocator.h"
+
+#include "rx/core/utility/forward.h"
+
 #include "rx/core/hints/unlikely.h"
 #include "rx/core/hints/empty_bases.h"
 
 namespace rx {
 
+// # Static Pool
+//
+// Fixed number of equally sized objects in a single allocation, referred to by
+// index.
+//
+// Free objects are tracked in a hierarchy of bitmaps. The first level has a bit
+// set for every free object, every next level has a bit set for every word of
+// the level below with a bit set, up to a level of a single word. Allocation
+// descends the levels with a count of trailing zeros per level, always finding
+// the lowest free index, and allocation and deallocation only update the levels
+// above a word which became full or stopped being full. Both take one step per
+// 64x of capacity. The number of allocated objects is kept as a count.
 struct RX_HINT_EMPTY_BASES static_pool
   : concepts::no_copy
 {
@@ -40,13 +56,28 @@ struct RX_HINT_EMPTY_BASES static_pool
   rx_size index_of(const rx_byte* _data) const;
 
   bool owns(const rx_byte* _data) const;
+  bool is_allocated(rx_size _index) const;
+
+  const rx_byte* data() const;
 
 private:
+  using word = rx_u64;
+
+  static constexpr const rx_size k_word_bits{sizeof(word) * 8};
+  static constexpr const rx_size k_max_levels{(sizeof(rx_size) * 8 + 5) / 6};
+
+  void release();
+
   ref<memory::allocator> m_allocator;
   rx_size m_object_size;
   rx_size m_capacity;
+  rx_size m_size;
   rx_byte* m_data;
-  bitset m_bitset;
+
+  // Every level of the bitmap in one allocation, the first level first.
+  word* m_bitmap;
+  rx_size m_levels;
+  rx_size m_level_offsets[k_max_levels];
 };
 
 inline static_pool::static_pool(rx_size _object_size, rx_size _object_count)
@@ -55,8 +86,7 @@ inline static_pool::static_pool(rx_size _object_size, rx_size _object_count)
 }
 
 inline static_pool::~static_pool() {
-  RX_ASSERT(m_bitset.count_set_bits() == 0, "leaked objects");
-  allocator().deallocate(m_data);
+  release();
 }
 
 inline rx_byte* static_pool::operator[](rx_size _index) const {
@@ -99,20 +129,20 @@ RX_HINT_FORCE_INLINE rx_size static_pool::capacity() const {
 }
 
 RX_HINT_FORCE_INLINE rx_size static_pool::size() const {
-  return m_bitset.count_set_bits();
+  return m_size;
 }
 
 RX_HINT_FORCE_INLINE bool static_pool::is_empty() const {
   return size() == 0;
 }
 
-inline bool static_pool::can_allocate() const {
-  return m_bitset.count_unset_bits() != 0;
+RX_HINT_FORCE_INLINE bool static_pool::can_allocate() const {
+  return m_size != m_capacity;
 }
 
 inline rx_byte* static_pool::data_of(rx_size _index) const {
   RX_ASSERT(_index < m_capacity, "out of bounds");
-  RX_ASSERT(m_bitset.test(_index), "unallocated (%zu)", _index);
+  RX_ASSERT(is_allocated(_index), "unallocated (%zu)", _index);
   return m_data + m_object_size * _index;
 }
 
@@ -125,6 +155,15 @@ inline bool static_pool::owns(const rx_byte* _data) const {
   return _data >= m_data && _data <= m_data + m_object_size * (m_capacity - 1);
 }
 
+inline bool static_pool::is_allocated(rx_size _index) const {
+  RX_ASSERT(_index < m_capacity, "out of bounds");
+  return !(m_bitmap[_index / k_word_bits] & (word{1} << (_index % k_word_bits)));
+}
+
+RX_HINT_FORCE_INLINE const rx_byte* static_pool::data() const {
+  return m_data;
+}
+
 } // namespace rx
 
-#endif // RX_CORE_POOL_H
+#endif // RX_CORE_STATIC_POOL_H
@@ -5,6 +5,9 @@
 template<typename T>
 inline rx_size bit_search_lsb(T _bits);
 
+template<typename T>
+inline rx_size bit_search_msb(T _bits);
+
 template<typename T>
 inline rx_size bit_pop_count(T _bits);
 
@@ -20,6 +23,16 @@ inline rx_size bit_search_lsb(rx_u64 _bits) {
   return _bits ? __builtin_ctzll(_bits) : 64;
 }
 
+template<>
+inline rx_size bit_search_msb(rx_u32 _bits) {
+  return _bits ? 31 - __builtin_clz(_bits) : 32;
+}
+
+template<>
+inline rx_size bit_search_msb(rx_u64 _bits) {
+  return _bits ? 63 - __builtin_clzll(_bits) : 64;
+}
+
 template<>
 inline rx_size bit_pop_count(rx_u32 _bits) {
   return __builtin_popcountl(_bits);
@@ -82,6 +95,35 @@ inline rx_size bit_pop_count(rx_u64 _bits) {
   // return left 8 bits
   return (_bits * k_h0) >> 56;
 }
+
+// fill every bit below the highest set bit, the highest bit is one less than
+// the number of set bits
+template<>
+inline rx_size bit_search_msb(rx_u32 _bits) {
+  if (!_bits) {
+    return 32;
+  }
+  _bits |= _bits >> 1;
+  _bits |= _bits >> 2;
+  _bits |= _bits >> 4;
+  _bits |= _bits >> 8;
+  _bits |= _bits >> 16;
+  return bit_pop_count(_bits) - 1;
+}
+
+template<>
+inline rx_size bit_search_msb(rx_u64 _bits) {
+  if (!_bits) {
+    return 64;
+  }
+  _bits |= _bits >> 1;
+  _bits |= _bits >> 2;
+  _bits |= _bits >> 4;
+  _bits |= _bits >> 8;
+  _bits |= _bits >> 16;
+  _bits |= _bits >> 32;
+  return bit_pop_count(_bits) - 1;
+}
 #endif
 
 template<typename T>
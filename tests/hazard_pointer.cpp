@@ -0,0 +1,162 @@
+#include <stdio.h> // printf
+
+#include "rx/core/concurrency/hazard_pointer.h"
+#include "rx/core/concurrency/thread.h"
+#include "rx/core/memory/system_allocator.h"
+#include "rx/core/global.h"
+
+// # Hazard Pointer Stress Test
+//
+// Threads push and pop a shared Treiber stack, retiring every popped node
+// through the hazard domain. Nodes poison themselves when destroyed, so a pop
+// which reads a reclaimed node is caught. The number of nodes alive at once,
+// retired ones included, is checked against the bound on garbage. Run it under
+// ASan and TSan as well.
+
+using namespace rx;
+using namespace rx::concurrency;
+
+static constexpr const rx_size k_threads{8};
+static constexpr const rx_size k_rounds{4};
+// Every allocation maps pages of its own with the electric fence allocator.
+#if defined(RX_ESAN)
+static constexpr const rx_size k_iterations{2000};
+#else
+static constexpr const rx_size k_iterations{20000};
+#endif
+
+static atomic<rx_size> g_live{0};
+static atomic<rx_size> g_use_after_free{0};
+
+struct node {
+  node(rx_size _value)
+    : value{_value}
+    , next{nullptr}
+  {
+    g_live.fetch_add(1, memory_order::k_relaxed);
+  }
+
+  ~node() {
+    value = -1_z;
+    g_live.fetch_sub(1, memory_order::k_relaxed);
+  }
+
+  rx_size value;
+  node* next;
+};
+
+struct stack {
+  void push(node* _node) {
+    _node->next = m_head.load(memory_order::k_relaxed);
+    while (!m_head.compare_exchange_weak(_node->next, _node,
+      memory_order::k_release, memory_order::k_relaxed))
+    {
+      // { empty }
+    }
+  }
+
+  node* pop(hazard_domain::participant& _participant) {
+    for (;;) {
+      node* head{_participant.protect(0, m_head)};
+      if (!head) {
+        return nullptr;
+      }
+
+      if (head->value == -1_z) {
+        g_use_after_free.fetch_add(1, memory_order::k_relaxed);
+      }
+
+      if (m_head.compare_exchange_weak(head, head->next,
+        memory_order::k_acquire, memory_order::k_relaxed))
+      {
+        _participant.reset(0);
+        return head;
+      }
+    }
+  }
+
+private:
+  atomic<node*> m_head{nullptr};
+};
+
+static bool run() {
+  auto& allocator{memory::system_allocator::instance()};
+
+  hazard_domain domain{allocator};
+  stack nodes;
+  atomic<rx_size> max_live{0};
+
+  vector<thread> threads;
+  for (rx_size i{0}; i < k_threads; i++) {
+    threads.emplace_back("hazard pointer test", [&](int) {
+      for (rx_size round{0}; round < k_rounds; round++) {
+        hazard_domain::participant participant{domain};
+        for (rx_size j{0}; j < k_iterations; j++) {
+          nodes.push(allocator.create<node>(j));
+          if (node* popped = nodes.pop(participant)) {
+            participant.retire(allocator, popped);
+          }
+
+          const rx_size live{g_live.load(memory_order::k_relaxed)};
+          rx_size max{max_live.load(memory_order::k_relaxed)};
+          while (live > max && !max_live.compare_exchange_weak(max, live,
+            memory_order::k_relaxed, memory_order::k_relaxed))
+          {
+            // { empty }
+          }
+        }
+      }
+    });
+  }
+
+  threads.each_fwd([](thread& _thread) {
+    _thread.join();
+  });
+
+  {
+    hazard_domain::participant participant{domain};
+    while (node* popped = nodes.pop(participant)) {
+      participant.retire(allocator, popped);
+    }
+  }
+
+  // Every participant holds at most its scan threshold of garbage plus what
+  // every hazard pointer protects, and every thread at most one node on the
+  // stack.
+  const rx_size records{k_threads + 1};
+  const rx_size threshold{hazard_domain::k_hazards * records * 2 > hazard_domain::k_scan_threshold
+    ? hazard_domain::k_hazards * records * 2 : hazard_domain::k_scan_threshold};
+  const rx_size bound{k_threads * (threshold + hazard_domain::k_hazards * records) + k_threads};
+
+  const rx_size use_after_free{g_use_after_free.load(memory_order::k_relaxed)};
+  printf("max live %zu (bound %zu), use after free %zu\n", max_live.load(memory_order::k_relaxed),
+    bound, use_after_free);
+
+  return use_after_free == 0 && max_live.load(memory_order::k_relaxed) <= bound;
+}
+
+int main() {
+  globals::link();
+
+  // The allocators have to exist before the other globals are initialized.
+  auto system{globals::find("system")};
+  system->find("heap_allocator")->init();
+#if defined(RX_ESAN)
+  system->find("electric_fence_allocator")->init();
+#endif
+  system->find("allocator")->init();
+  globals::init();
+
+  bool passed{run()};
+
+  // Destroying the domain frees everything retired to it.
+  const rx_size live{g_live.load(memory_order::k_relaxed)};
+  if (live != 0) {
+    printf("%zu nodes leaked\n", live);
+    passed = false;
+  }
+
+  globals::fini();
+
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+#include <stdio.h> // printf
+#include <stdlib.h> // strtoul
+
+#include "rx/core/concurrency/thread_pool.h"
+#include "rx/core/concurrency/topology.h"
+#include "rx/core/concurrency/wait_group.h"
+#include "rx/core/concurrency/cache_line.h"
+#include "rx/core/time/qpc.h"
+#include "rx/core/global.h"
+
+// # Thread Pool Scaling Benchmark
+//
+// Measures the throughput of the pool for tiny jobs with 1, 2, 4 and so on up
+// to as many workers as there are logical cores. Jobs are added from outside
+// the pool as roots which each add their children from a worker, so both the
+// round-robin path and the worker local path with stealing are exercised. The
+// children do nothing but count down the children of their root.
+//
+// The most workers can be given as the first argument instead.
+
+using namespace rx;
+using namespace rx::concurrency;
+
+static constexpr const rx_size k_roots{1024};
+
+// Jobs which don't fit the static pool of the thread pool map pages of their
+// own with the electric fence allocator.
+#if defined(RX_ESAN)
+static constexpr const rx_size k_children{64};
+#else
+static constexpr const rx_size k_children{1024};
+#endif
+
+static constexpr const rx_size k_jobs{k_roots * (k_children + 1)};
+
+// Each root on its own cache line so children of different roots don't share.
+struct alignas(k_cache_line) root {
+  atomic<rx_size> remaining;
+};
+
+static root g_roots[k_roots];
+
+static rx_f64 run(rx_size _workers) {
+  thread_pool pool{_workers, 4096};
+  wait_group done{k_roots};
+
+  const rx_u64 start{time::qpc_ticks()};
+
+  for (rx_size i{0}; i < k_roots; i++) {
+    g_roots[i].remaining.store(k_children, memory_order::k_relaxed);
+    pool.add([&pool, &done, i](int) {
+      for (rx_size j{0}; j < k_children; j++) {
+        pool.add([&done, i](int) {
+          if (g_roots[i].remaining.fetch_sub(1, memory_order::k_acq_rel) == 1) {
+            done.signal();
+          }
+        });
+      }
+    });
+  }
+
+  done.wait();
+
+  const rx_f64 seconds{static_cast<rx_f64>(time::qpc_ticks() - start)
+    / static_cast<rx_f64>(time::qpc_frequency())};
+
+  return static_cast<rx_f64>(k_jobs) / seconds;
+}
+
+int main(int _argc, char** _argv) {
+  globals::link();
+
+  // The allocators have to exist before the other globals are initialized.
+  auto system{globals::find("system")};
+  system->find("heap_allocator")->init();
+#if defined(RX_ESAN)
+  system->find("electric_fence_allocator")->init();
+#endif
+  system->find("allocator")->init();
+  globals::init();
+
+  rx_size cores{_argc > 1 ? strtoul(_argv[1], nullptr, 10) : topology{}.logical_cores()};
+  if (cores == 0) {
+    cores = 1;
+  }
+
+  printf("%zu jobs, up to %zu workers\n", k_jobs, cores);
+
+  rx_f64 single{0.0};
+  for (rx_size workers{1}; ; workers *= 2) {
+    if (workers > cores) {
+      workers = cores;
+    }
+
+    const rx_f64 jobs_per_second{run(workers)};
+    if (workers == 1) {
+      single = jobs_per_second;
+    }
+
+    printf("%3zu workers: %12.0f jobs/s (%.2fx)\n", workers, jobs_per_second,
+      jobs_per_second / single);
+
+    if (workers == cores) {
+      break;
+    }
+  }
+
+  globals::fini();
+
+  return 0;
+}